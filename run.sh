@@ -9,6 +9,10 @@ PRUNING_STRATEGY="prune_opt"
 TC_CONSTRUCTION="purdom+"
 TC_UPDATE="italino+"
 SAT_STRATEGY="vboxsat"
+LOADER="stream"
+THREADS="1"
+ARENA="false"
+WITNESS="false"
 
 
 if [ $# -gt 0 ]; then
@@ -21,9 +25,13 @@ if [ $# -gt 0 ]; then
     TC_CONSTRUCTION="$7"
     TC_UPDATE="$8"
     SAT_STRATEGY="$9"
+    LOADER="${10:-stream}"
+    THREADS="${11:-1}"
+    ARENA="${12:-false}"
+    WITNESS="${13:-false}"
 fi
 
-./build/SerVerifier "$LOG_DIR" "$VERIFIER" "$TIMING_ENABLED" "$COMPACTION_ENABLED" "$MERGING_ENABLED" "$PRUNING_STRATEGY" "$TC_CONSTRUCTION" "$TC_UPDATE" "$SAT_STRATEGY"
+./build/SerVerifier "$LOG_DIR" "$VERIFIER" "$TIMING_ENABLED" "$COMPACTION_ENABLED" "$MERGING_ENABLED" "$PRUNING_STRATEGY" "$TC_CONSTRUCTION" "$TC_UPDATE" "$SAT_STRATEGY" "$LOADER" "$THREADS" "$ARENA" "$WITNESS"
 
 if [ $? -eq 0 ]; then
     echo "Verification completed successfully."
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <string>
+
+#include "options.h"
+#include "transaction/transaction.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc < 4)
+    {
+        cout << "====================== Usage Instructions ======================\n";
+        cout << "Usage:\n";
+        cout << "  " << argv[0] << " v2 <log> <output> <loader> <threads> <time_index>\n";
+        cout << "  " << argv[0] << " zlib <log> <output> <threads> <block_kb> <level>\n";
+        cout << "\nParameters:\n";
+        cout << "  <log>         Path to the directory containing the log files.\n";
+        cout << "  <output>      v2: path of the history file to write, e.g. <log>/history.v2\n";
+        cout << "                zlib: directory receiving one .zlog file per session\n";
+        cout << "  <loader>      Log loader backend. Options are: stream / mmap\n";
+        cout << "  <threads>     Number of worker threads. Default is 1\n";
+        cout << "  <time_index>  Store the global start-time order. Options are: true / false\n";
+        cout << "  <block_kb>    Uncompressed block size in KiB. Default is 1024\n";
+        cout << "  <level>       zlib compression level, 1-9. Default is 6\n";
+        cout << "\nExample:\n";
+        cout << "  " << argv[0] << " v2 /path/to/logs /path/to/logs/history.v2 mmap 4 true\n";
+        cout << "  " << argv[0] << " zlib /path/to/logs /path/to/logs 4 1024 6\n";
+        cout << "===============================================================\n";
+        return argc == 1 ? 0 : 1;
+    }
+    string format = argv[1];
+    VerifyOptions options;
+    options.log = argv[2];
+    string target = argv[3];
+
+    bool converted = false;
+    auto start = chrono::high_resolution_clock::now();
+    TransactionManager manager;
+    if (format == "v2")
+    {
+        if (argc > 4)
+            options.loader = argv[4];
+        if (argc > 5)
+            options.threads = stoi(argv[5]);
+        bool time_index = argc <= 6 || string(argv[6]) == "true";
+        converted = manager.convert(options, target, time_index);
+    }
+    else if (format == "zlib")
+    {
+        if (argc > 4)
+            options.threads = stoi(argv[4]);
+        uint32_t block_kb = argc > 5 ? stoul(argv[5]) : 1024;
+        int level = argc > 6 ? stoi(argv[6]) : 6;
+        converted = manager.compress(options, target, block_kb << 10, level);
+    }
+    else
+    {
+        cerr << "Unknown format " << format << endl;
+        return 1;
+    }
+    if (!converted)
+    {
+        cerr << "Failed to convert " << options.log << " to " << target << endl;
+        return 1;
+    }
+    auto end = chrono::high_resolution_clock::now();
+    cout << "Conversion Time Taken: " << chrono::duration_cast<chrono::microseconds>(end - start).count() << " us" << endl;
+    return 0;
+}
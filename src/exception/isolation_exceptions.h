@@ -4,6 +4,7 @@
 #include <exception>
 #include <string>
 #include <sstream>
+#include <vector>
 #include "graph/graph.h"
 class ISException : public std::exception
 {
@@ -21,14 +22,14 @@ private:
 class AbortedReads : public ISException
 {
 public:
-    explicit AbortedReads(Read *read)
+    explicit AbortedReads(const std::string &read)
         : ISException(buildMessage(read)) {}
 
 private:
-    static std::string buildMessage(Read *read)
+    static std::string buildMessage(const std::string &read)
     {
         std::ostringstream oss;
-        oss << "Aborted Reads. \n Read Operator: " << read->to_string();
+        oss << "Aborted Reads. \n Read Operator: " << read;
         return oss.str();
     }
 };
@@ -51,14 +52,14 @@ private:
 class IntermediateReads : public ISException
 {
 public:
-    explicit IntermediateReads(Transaction *txn, Read *read)
+    explicit IntermediateReads(Transaction *txn, const std::string &read)
         : ISException(buildMessage(txn, read)) {}
 
 private:
-    static std::string buildMessage(Transaction *txn, Read *read)
+    static std::string buildMessage(Transaction *txn, const std::string &read)
     {
         std::ostringstream oss;
-        oss << "Intermediate Reads. \n Read Operator: " << read->to_string() << "\n Read From Transaction:" << txn->to_string();
+        oss << "Intermediate Reads. \n Read Operator: " << read << "\n Read From Transaction:" << txn->to_string();
         return oss.str();
     }
 };
@@ -66,14 +67,14 @@ private:
 class InconsistentReads : public ISException
 {
 public:
-    explicit InconsistentReads(Read *read)
+    explicit InconsistentReads(const std::string &read)
         : ISException(buildMessage(read)) {}
 
 private:
-    static std::string buildMessage(Read *read)
+    static std::string buildMessage(const std::string &read)
     {
         std::ostringstream oss;
-        oss << "Inconsistent Reads. \n Read Operator: " << read->to_string();
+        oss << "Inconsistent Reads. \n Read Operator: " << read;
         return oss.str();
     }
 };
@@ -130,6 +131,38 @@ public:
         : ISException(message) {}
 };
 
+// A cycle among committed dependencies, found while ordering the graph for the
+// closure: the edges of one concrete cycle and the size of the strongly connected
+// component holding it.
+class DependencyCycle : public SerializableException
+{
+public:
+    DependencyCycle(const std::string &strategy, const std::vector<DSG::Edge> &cycle, size_t component, const std::vector<Vertex> &vertices)
+        : SerializableException(buildMessage(strategy, cycle, component, vertices)), cycle_(cycle), component_(component) {}
+    const std::vector<DSG::Edge> &cycle() const { return cycle_; }
+    size_t component() const { return component_; }
+
+private:
+    static std::string buildMessage(const std::string &strategy, const std::vector<DSG::Edge> &cycle, size_t component, const std::vector<Vertex> &vertices)
+    {
+        std::ostringstream oss;
+        oss << strategy << ":cycle. \n Strongly Connected Component: " << component << " transactions\n Cycle:";
+        for (const DSG::Edge &e : cycle)
+        {
+            oss << " " << e.from() << " ->";
+        }
+        oss << " " << cycle.front().from();
+        for (const DSG::Edge &e : cycle)
+        {
+            oss << "\n Transaction " << e.from() << ": " << vertices[e.from()].to_string();
+        }
+        return oss.str();
+    }
+
+    std::vector<DSG::Edge> cycle_;
+    size_t component_;
+};
+
 class IsoException3 : public ISException
 {
 public:
@@ -1,4 +1,5 @@
 #include "graph.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -14,24 +15,34 @@ void Vertex::set_right(uint32_t right) { right_ = (right_ == UINT32_MAX) ? right
 uint64_t Vertex::start() const { return trx_->start(); }
 uint64_t Vertex::end() const { return trx_->end(); }
 
-const unordered_map<uint64_t, unordered_set<uint32_t>> &Vertex::reads() const { return reads_; }
-void Vertex::set_read(uint64_t k, uint32_t v) { reads_[k].insert(v); }
+const unordered_map<uint32_t, unordered_set<uint32_t>> &Vertex::reads() const { return reads_; }
+void Vertex::set_read(uint32_t k, uint32_t v) { reads_[k].insert(v); }
 
-const unordered_map<uint64_t, Write *> &Vertex::writes() const { return writes_; }
-void Vertex::set_write(uint64_t k, Write *w)
+const vector<pair<uint32_t, Write>> &Vertex::writes() const { return writes_; }
+
+static bool write_key_less(const pair<uint32_t, Write> &w, uint32_t key) { return w.first < key; }
+
+const Write *Vertex::write(uint32_t k) const
+{
+    auto it = lower_bound(writes_.begin(), writes_.end(), k, write_key_less);
+    return (it != writes_.end() && it->first == k) ? &it->second : nullptr;
+}
+
+void Vertex::set_write(uint32_t k, const Write &w)
 {
-    if (writes_.count(k) > 0)
+    auto it = lower_bound(writes_.begin(), writes_.end(), k, write_key_less);
+    if (it != writes_.end() && it->first == k)
     {
-        writes_[k]->combine(w);
+        it->second.combine(w);
     }
     else
     {
-        writes_[k] = w;
+        writes_.emplace(it, k, w);
     }
 }
 
-void Vertex::set_predicate(Predicate *p) { predicates_.insert(p); }
-const unordered_set<Predicate *> Vertex::predicates() const { return predicates_; }
+void Vertex::set_predicate(const Predicate *p) { predicates_.insert(p); }
+const unordered_set<const Predicate *> &Vertex::predicates() const { return predicates_; }
 
 void Vertex::clear()
 {
@@ -4,6 +4,8 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <queue>
+#include <utility>
+#include <vector>
 
 #include "transaction/transaction.h"
 
@@ -33,13 +35,15 @@ public:
     uint64_t start() const;
     uint64_t end() const;
 
-    const std::unordered_map<uint64_t, std::unordered_set<uint32_t>> &reads() const;
-    void set_read(uint64_t k, uint32_t v);
+    // keys are the dense ids of OperatorStore::key_id()
+    const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &reads() const;
+    void set_read(uint32_t k, uint32_t v);
 
-    const std::unordered_map<uint64_t, Write *> &writes() const;
-    void set_write(uint64_t k, Write *w);
-    void set_predicate(Predicate *p);
-    const std::unordered_set<Predicate *> predicates() const;
+    const std::vector<std::pair<uint32_t, Write>> &writes() const; // sorted by key
+    const Write *write(uint32_t k) const;                           // nullptr if k is not written
+    void set_write(uint32_t k, const Write &w);                     // combined with an earlier write to k
+    void set_predicate(const Predicate *p);
+    const std::unordered_set<const Predicate *> &predicates() const;
     void clear();
     Transaction *transaction() const;
 
@@ -50,9 +54,9 @@ private:
     uint32_t index_;
     uint32_t left_ = 0;
     uint32_t right_ = UINT32_MAX;
-    std::unordered_map<uint64_t, std::unordered_set<uint32_t>> reads_;
-    std::unordered_map<uint64_t, Write *> writes_;
-    std::unordered_set<Predicate *> predicates_;
+    std::unordered_map<uint32_t, std::unordered_set<uint32_t>> reads_;
+    std::vector<std::pair<uint32_t, Write>> writes_;
+    std::unordered_set<const Predicate *> predicates_;
 };
 
 namespace DSG
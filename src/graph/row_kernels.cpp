@@ -0,0 +1,347 @@
+#include "row_kernels.h"
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROW_KERNELS_X86
+#endif
+
+using namespace std;
+
+static bool merge_scalar(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    uint64_t changed = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        changed |= src[i] & ~dst[i];
+        dst[i] |= src[i];
+    }
+    return changed != 0;
+}
+
+static void clear_scalar(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        dst[i] &= ~src[i];
+    }
+}
+
+static size_t popcount_scalar(const uint64_t *src, size_t n)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        count += __builtin_popcountll(src[i]);
+    }
+    return count;
+}
+
+static bool fresh_scalar(uint64_t *out, const uint64_t *src, const uint64_t *mask, size_t n)
+{
+    uint64_t any = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = src[i] & ~mask[i];
+        any |= out[i];
+    }
+    return any != 0;
+}
+
+static const RowKernels scalar_kernels{"scalar", merge_scalar, clear_scalar, popcount_scalar, fresh_scalar};
+
+#ifdef ROW_KERNELS_X86
+
+///////////////////////////////////////////////////////////////////////
+// SSE2: two words per step
+
+__attribute__((target("sse2"))) static bool merge_sse2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    __m128i changed = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        changed = _mm_or_si128(changed, _mm_andnot_si128(d, s));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_or_si128(d, s));
+    }
+    bool any = _mm_movemask_epi8(_mm_cmpeq_epi8(changed, _mm_setzero_si128())) != 0xFFFF;
+    return merge_scalar(dst + i, src + i, n - i) || any;
+}
+
+__attribute__((target("sse2"))) static void clear_sse2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_andnot_si128(s, d));
+    }
+    clear_scalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("sse2"))) static bool fresh_sse2(uint64_t *out, const uint64_t *src, const uint64_t *mask, size_t n)
+{
+    __m128i any = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i o = _mm_andnot_si128(m, s);
+        any = _mm_or_si128(any, o);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), o);
+    }
+    bool found = _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xFFFF;
+    return fresh_scalar(out + i, src + i, mask + i, n - i) || found;
+}
+
+// SSE2 has no population count instruction
+static const RowKernels sse2_kernels{"sse2", merge_sse2, clear_sse2, popcount_scalar, fresh_sse2};
+
+///////////////////////////////////////////////////////////////////////
+// AVX2: four words per step
+
+__attribute__((target("avx2"))) static bool merge_avx2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    __m256i changed = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        changed = _mm256_or_si256(changed, _mm256_andnot_si256(d, s));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_or_si256(d, s));
+    }
+    bool any = !_mm256_testz_si256(changed, changed);
+    return merge_scalar(dst + i, src + i, n - i) || any;
+}
+
+__attribute__((target("avx2"))) static void clear_avx2(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dst + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_andnot_si256(s, d));
+    }
+    clear_scalar(dst + i, src + i, n - i);
+}
+
+// nibble lookup per byte, summed per 64-bit lane with psadbw
+__attribute__((target("avx2"))) static size_t popcount_avx2(const uint64_t *src, size_t n)
+{
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+        __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcount_scalar(src + i, n - i);
+}
+
+__attribute__((target("avx2"))) static bool fresh_avx2(uint64_t *out, const uint64_t *src, const uint64_t *mask, size_t n)
+{
+    __m256i any = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i o = _mm256_andnot_si256(m, s);
+        any = _mm256_or_si256(any, o);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), o);
+    }
+    bool found = !_mm256_testz_si256(any, any);
+    return fresh_scalar(out + i, src + i, mask + i, n - i) || found;
+}
+
+static const RowKernels avx2_kernels{"avx2", merge_avx2, clear_avx2, popcount_avx2, fresh_avx2};
+
+///////////////////////////////////////////////////////////////////////
+// AVX-512F: eight words per step
+
+// ~a & b; GCC 12's _mm512_andnot_si512 trips -Wmaybe-uninitialized in its own header
+__attribute__((target("avx512f"))) static inline __m512i andnot_avx512(__m512i a, __m512i b)
+{
+    return _mm512_ternarylogic_epi64(a, b, b, 0x0C);
+}
+
+__attribute__((target("avx512f"))) static bool merge_avx512(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    __m512i changed = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i d = _mm512_loadu_si512(dst + i);
+        __m512i s = _mm512_loadu_si512(src + i);
+        changed = _mm512_or_si512(changed, andnot_avx512(d, s));
+        _mm512_storeu_si512(dst + i, _mm512_or_si512(d, s));
+    }
+    bool any = _mm512_test_epi64_mask(changed, changed) != 0;
+    return merge_scalar(dst + i, src + i, n - i) || any;
+}
+
+__attribute__((target("avx512f"))) static void clear_avx512(uint64_t *dst, const uint64_t *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i d = _mm512_loadu_si512(dst + i);
+        __m512i s = _mm512_loadu_si512(src + i);
+        _mm512_storeu_si512(dst + i, andnot_avx512(s, d));
+    }
+    clear_scalar(dst + i, src + i, n - i);
+}
+
+// v >> bits per 64-bit lane; _mm512_srli_epi64 has the same header problem
+__attribute__((target("avx512f"))) static inline __m512i srli_avx512(__m512i v, unsigned int bits)
+{
+    return _mm512_maskz_srli_epi64(0xFF, v, bits);
+}
+
+// bit-sliced count per 64-bit lane; the byte shuffles of the AVX2 version would need AVX-512BW
+__attribute__((target("avx512f"))) static size_t popcount_avx512(const uint64_t *src, size_t n)
+{
+    const __m512i m1 = _mm512_set1_epi64(0x5555555555555555ULL);
+    const __m512i m2 = _mm512_set1_epi64(0x3333333333333333ULL);
+    const __m512i m4 = _mm512_set1_epi64(0x0F0F0F0F0F0F0F0FULL);
+    __m512i total = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i v = _mm512_loadu_si512(src + i);
+        v = _mm512_sub_epi64(v, _mm512_and_si512(srli_avx512(v, 1), m1));
+        v = _mm512_add_epi64(_mm512_and_si512(v, m2), _mm512_and_si512(srli_avx512(v, 2), m2));
+        v = _mm512_and_si512(_mm512_add_epi64(v, srli_avx512(v, 4)), m4);
+        v = _mm512_add_epi64(v, srli_avx512(v, 8));
+        v = _mm512_add_epi64(v, srli_avx512(v, 16));
+        v = _mm512_add_epi64(v, srli_avx512(v, 32));
+        total = _mm512_add_epi64(total, _mm512_and_si512(v, _mm512_set1_epi64(0x7F)));
+    }
+    uint64_t lanes[8];
+    _mm512_storeu_si512(lanes, total);
+    size_t count = popcount_scalar(src + i, n - i);
+    for (uint64_t lane : lanes)
+    {
+        count += lane;
+    }
+    return count;
+}
+
+__attribute__((target("avx512f"))) static bool fresh_avx512(uint64_t *out, const uint64_t *src, const uint64_t *mask, size_t n)
+{
+    __m512i any = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i m = _mm512_loadu_si512(mask + i);
+        __m512i s = _mm512_loadu_si512(src + i);
+        __m512i o = andnot_avx512(m, s);
+        any = _mm512_or_si512(any, o);
+        _mm512_storeu_si512(out + i, o);
+    }
+    bool found = _mm512_test_epi64_mask(any, any) != 0;
+    return fresh_scalar(out + i, src + i, mask + i, n - i) || found;
+}
+
+static const RowKernels avx512_kernels{"avx512", merge_avx512, clear_avx512, popcount_avx512, fresh_avx512};
+
+#endif // ROW_KERNELS_X86
+
+vector<const RowKernels *> supported_row_kernels()
+{
+    vector<const RowKernels *> kernels{&scalar_kernels};
+#ifdef ROW_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        kernels.push_back(&sse2_kernels);
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        kernels.push_back(&avx2_kernels);
+    }
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        kernels.push_back(&avx512_kernels);
+    }
+#endif
+    return kernels;
+}
+
+bool row_kernels_self_test(const RowKernels &kernels)
+{
+    mt19937_64 rng(0x5eed);
+    // lengths around every vector width, at offsets that break alignment
+    for (size_t n = 0; n <= 40; ++n)
+    {
+        for (size_t offset = 0; offset < 3; ++offset)
+        {
+            vector<uint64_t> src(n + offset), dst(n + offset), out(n + offset), expect(n + offset), expect_out(n + offset);
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                // sparse, dense and empty words all show up
+                src[i] = i % 5 == 0 ? 0 : rng() & rng();
+                dst[i] = i % 7 == 0 ? src[i] : rng() | rng();
+            }
+            if (kernels.popcount(src.data() + offset, n) != popcount_scalar(src.data() + offset, n))
+            {
+                return false;
+            }
+            bool found = kernels.fresh(out.data() + offset, src.data() + offset, dst.data() + offset, n);
+            bool expect_found = fresh_scalar(expect_out.data() + offset, src.data() + offset, dst.data() + offset, n);
+            if (found != expect_found || out != expect_out)
+            {
+                return false;
+            }
+            expect = dst;
+            bool changed = kernels.merge(dst.data() + offset, src.data() + offset, n);
+            bool expect_changed = merge_scalar(expect.data() + offset, src.data() + offset, n);
+            if (changed != expect_changed || dst != expect)
+            {
+                return false;
+            }
+            // merging again changes nothing
+            if (kernels.merge(dst.data() + offset, src.data() + offset, n))
+            {
+                return false;
+            }
+            kernels.clear(dst.data() + offset, src.data() + offset, n);
+            clear_scalar(expect.data() + offset, src.data() + offset, n);
+            if (dst != expect)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const RowKernels &row_kernels()
+{
+    static const RowKernels *selected = []()
+    {
+        vector<const RowKernels *> kernels = supported_row_kernels();
+        for (auto it = kernels.rbegin(); it != kernels.rend(); ++it)
+        {
+            if (row_kernels_self_test(**it))
+            {
+                return *it;
+            }
+        }
+        return &scalar_kernels;
+    }();
+    return *selected;
+}
@@ -0,0 +1,30 @@
+#ifndef ROW_KERNELS_H
+#define ROW_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Operations on runs of 64-bit words, as used by the closure rows. Every ISA
+// variant computes the same bits; the best one the CPU supports is picked once.
+struct RowKernels
+{
+    const char *isa;
+    // dst |= src, true if dst changed
+    bool (*merge)(uint64_t *dst, const uint64_t *src, size_t n);
+    // dst &= ~src
+    void (*clear)(uint64_t *dst, const uint64_t *src, size_t n);
+    // number of set bits
+    size_t (*popcount)(const uint64_t *src, size_t n);
+    // out = src & ~mask, true if any bit of out is set
+    bool (*fresh)(uint64_t *out, const uint64_t *src, const uint64_t *mask, size_t n);
+};
+
+// kernels of the widest ISA available that passes row_kernels_self_test()
+const RowKernels &row_kernels();
+// every variant the CPU can run, scalar first
+std::vector<const RowKernels *> supported_row_kernels();
+// runs `kernels` against the scalar ones on random rows, true if all results match
+bool row_kernels_self_test(const RowKernels &kernels);
+
+#endif // ROW_KERNELS_H
@@ -1,18 +1,290 @@
-#include <bitset>
 #include "transitive_closure.h"
 #include "exception/isolation_exceptions.h"
 #include <chrono>
 
 using namespace std;
 using DSG::Edge;
-StandardMatrix::StandardMatrix(size_t n)
-    : n_(n), reach_(n, vector<bool>(n, false)), parent_(n, vector<const Edge *>(n, nullptr)) {}
-bool StandardMatrix::reach(uint32_t from, uint32_t to) const { return reach_[from][to]; }
-void StandardMatrix::set_reach(uint32_t from, uint32_t to, bool is_reachable) { reach_[from][to] = is_reachable; }
-const Edge *StandardMatrix::parent(uint32_t from, uint32_t to) const { return parent_[from][to]; }
-void StandardMatrix::set_parent(uint32_t from, uint32_t to, const Edge *parent) { parent_[from][to] = parent; }
+
+// words per call to the fresh kernel in merge_row
+static const size_t FRESH_CHUNK = 64;
+// fewest rows worth handing to the worker pool
+static const size_t PARALLEL_GRAIN = 16;
+// fewest row words an italino+ update must span before it is split across the pool
+static const size_t PARALLEL_WORDS = 1 << 14;
+
+// ones from bit `shift` up
+static uint64_t low_mask(uint32_t shift) { return ~uint64_t(0) << shift; }
+// ones below bit `shift`, all ones for 0
+static uint64_t high_mask(uint32_t shift) { return shift == 0 ? ~uint64_t(0) : (uint64_t(1) << shift) - 1; }
+
+// 64 bits of a window row starting at bit b, which may lie outside it: the stored
+// bits inside the `width` bits of the window, zeros before it and ones after it
+static uint64_t window_bits(const uint64_t *row, size_t words, int64_t width, int64_t b)
+{
+    uint64_t bits = 0;
+    if (b > -64 && b < width)
+    {
+        if (b < 0)
+        {
+            bits = row[0] << -b;
+        }
+        else
+        {
+            size_t w = b / 64;
+            unsigned shift = b % 64;
+            bits = row[w] >> shift;
+            if (shift != 0 && w + 1 < words)
+            {
+                bits |= row[w + 1] << (64 - shift);
+            }
+        }
+    }
+    if (b + 64 > width)
+    {
+        int64_t ones = max<int64_t>(width - b, 0);
+        bits |= ~uint64_t(0) << ones;
+    }
+    return bits;
+}
+
+// dst |= the window row src, read from bit `shift` on (see window_bits)
+static void merge_window(uint64_t *dst, size_t n, int64_t shift, const uint64_t *src, size_t words, int64_t width)
+{
+    const RowKernels &kernels = row_kernels();
+    uint64_t gathered[FRESH_CHUNK];
+    int64_t full = width / 64; // words holding only window bits
+    for (size_t w = 0; w < n; w += FRESH_CHUNK)
+    {
+        size_t count = min(n - w, FRESH_CHUNK);
+        int64_t src_word = shift / 64 + int64_t(w);
+        if (shift % 64 == 0 && src_word >= 0 && src_word + int64_t(count) <= full)
+        {
+            kernels.merge(dst + w, src + src_word, count);
+            continue;
+        }
+        for (size_t k = 0; k < count; ++k)
+        {
+            gathered[k] = window_bits(src, words, width, shift + int64_t(w + k) * 64);
+        }
+        kernels.merge(dst + w, gathered, count);
+    }
+}
+
+// calls visit(w, bits) for every nonzero word src[w] & ~dst[w] of the n words, with
+// the first and last word cut down to first_mask and last_mask; visit may write dst[w]
+template <typename Visit>
+static void fresh_words(const uint64_t *src, const uint64_t *dst, size_t n, uint64_t first_mask, uint64_t last_mask, Visit visit)
+{
+    const RowKernels &kernels = row_kernels();
+    uint64_t out[FRESH_CHUNK];
+    for (size_t w = 0; w < n; w += FRESH_CHUNK)
+    {
+        size_t count = min(n - w, FRESH_CHUNK);
+        if (!kernels.fresh(out, src + w, dst + w, count))
+        {
+            continue;
+        }
+        if (w == 0)
+        {
+            out[0] &= first_mask;
+        }
+        if (w + count == n)
+        {
+            out[count - 1] &= last_mask;
+        }
+        for (size_t k = 0; k < count; ++k)
+        {
+            if (out[k] != 0)
+            {
+                visit(w + k, out[k]);
+            }
+        }
+    }
+}
+
+// mask = one bit per column offset from `base`, for the `count` ascending columns,
+// with mask[0] covering offsets from 64 * first on; returns first
+static size_t column_mask(const uint32_t *columns, size_t count, uint32_t base, vector<uint64_t> &mask)
+{
+    size_t first = (columns[0] - base) / 64;
+    mask.assign((columns[count - 1] - base) / 64 - first + 1, 0);
+    for (size_t k = 0; k < count; ++k)
+    {
+        uint32_t offset = columns[k] - base;
+        mask[offset / 64 - first] |= uint64_t(1) << (offset % 64);
+    }
+    return first;
+}
+
+WitnessStore::WitnessStore(size_t n, bool enabled) : enabled_(enabled)
+{
+    if (enabled_)
+    {
+        rows_.resize(n);
+    }
+}
+
+const Edge *WitnessStore::get(uint32_t from, uint32_t to) const
+{
+    if (!enabled_)
+    {
+        return nullptr;
+    }
+    const vector<Witness> &row = rows_[from];
+    auto it = lower_bound(row.begin(), row.end(), to, [](const Witness &w, uint32_t column)
+                          { return w.column < column; });
+    return it != row.end() && it->column == to ? &edges_[it->id] : nullptr;
+}
+
+void WitnessStore::set(uint32_t from, uint32_t to, const Edge *parent)
+{
+    if (!enabled_)
+    {
+        return;
+    }
+    if (parent != nullptr)
+    {
+        set(from, to, intern(*parent));
+        return;
+    }
+    vector<Witness> &row = rows_[from];
+    auto it = lower_bound(row.begin(), row.end(), to, [](const Witness &w, uint32_t column)
+                          { return w.column < column; });
+    if (it != row.end() && it->column == to)
+    {
+        row.erase(it);
+    }
+}
+
+uint32_t WitnessStore::intern(const Edge &parent)
+{
+    lock_guard<mutex> lock(intern_mutex_);
+    auto it = ids_.emplace(parent, edges_.size());
+    if (it.second)
+    {
+        edges_.push_back(parent);
+    }
+    return it.first->second;
+}
+
+void WitnessStore::set(uint32_t from, uint32_t to, uint32_t id)
+{
+    vector<Witness> &row = rows_[from];
+    // merge_row sets columns in ascending order, so most writes append
+    if (row.empty() || row.back().column < to)
+    {
+        row.push_back({to, id});
+        return;
+    }
+    auto it = lower_bound(row.begin(), row.end(), to, [](const Witness &w, uint32_t column)
+                          { return w.column < column; });
+    if (it != row.end() && it->column == to)
+    {
+        it->id = id;
+    }
+    else
+    {
+        row.insert(it, {to, id});
+    }
+}
+
+void WitnessStore::erase(uint32_t from, const uint32_t *columns, size_t count)
+{
+    if (!enabled_ || count == 0)
+    {
+        return;
+    }
+    vector<Witness> &row = rows_[from];
+    auto first = lower_bound(row.begin(), row.end(), columns[0], [](const Witness &w, uint32_t column)
+                             { return w.column < column; });
+    size_t k = 0;
+    auto last = remove_if(first, row.end(), [&](const Witness &w)
+                          {
+                              while (k < count && columns[k] < w.column)
+                              {
+                                  ++k;
+                              }
+                              return k < count && columns[k] == w.column; });
+    row.erase(last, row.end());
+}
+
+size_t WitnessStore::capacity() const
+{
+    size_t bytes = rows_.capacity() * sizeof(vector<Witness>) + edges_.size() * sizeof(Edge) +
+                   ids_.size() * (sizeof(Edge) + sizeof(uint32_t) + sizeof(void *));
+    for (const vector<Witness> &row : rows_)
+    {
+        bytes += row.capacity() * sizeof(Witness);
+    }
+    return bytes;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+StandardMatrix::StandardMatrix(size_t n, bool witness)
+    : n_(n), words_((n + 63) / 64), reach_(n * words_, 0), parent_(n, witness) {}
+bool StandardMatrix::reach(uint32_t from, uint32_t to) const { return (reach_[from * words_ + to / 64] >> (to % 64)) & 1; }
+void StandardMatrix::set_reach(uint32_t from, uint32_t to, bool is_reachable)
+{
+    uint64_t bit = uint64_t(1) << (to % 64);
+    uint64_t &word = reach_[from * words_ + to / 64];
+    word = is_reachable ? (word | bit) : (word & ~bit);
+}
+const Edge *StandardMatrix::parent(uint32_t from, uint32_t to) const { return parent_.get(from, to); }
+void StandardMatrix::set_parent(uint32_t from, uint32_t to, const Edge *parent) { parent_.set(from, to, parent); }
 size_t StandardMatrix::size() const { return n_; }
-size_t StandardMatrix::capacity() const { return n_ * n_ * (sizeof(bool) + sizeof(Edge *)); }
+size_t StandardMatrix::capacity() const { return n_ * words_ * sizeof(uint64_t) + parent_.capacity(); }
+
+void StandardMatrix::merge_row(uint32_t to, uint32_t from, uint32_t lo, uint32_t hi, const Edge *parent, vector<Edge> &added)
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+    uint64_t *row = reach_.data() + to * words_;
+    const uint64_t *src = reach_.data() + from * words_;
+    bool witness = parent != nullptr && parent_.enabled();
+    uint32_t id = witness ? parent_.intern(*parent) : 0;
+    size_t first = lo / 64;
+    fresh_words(src + first, row + first, (hi - 1) / 64 - first + 1, low_mask(lo % 64), high_mask(hi % 64),
+                [&](size_t w, uint64_t bits)
+                {
+                    w += first;
+                    row[w] |= bits;
+                    while (bits != 0)
+                    {
+                        uint32_t j = w * 64 + __builtin_ctzll(bits);
+                        bits &= bits - 1;
+                        added.emplace_back(to, j);
+                        if (witness)
+                        {
+                            parent_.set(to, j, id);
+                        }
+                    }
+                });
+}
+
+void StandardMatrix::fill_row(uint32_t from, uint32_t lo, uint32_t hi)
+{
+    uint64_t *row = reach_.data() + from * words_;
+    for (uint32_t j = lo; j < hi;)
+    {
+        uint32_t shift = j % 64;
+        uint32_t count = min<uint32_t>(64 - shift, hi - j);
+        row[j / 64] |= (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << shift;
+        j += count;
+    }
+}
+
+void StandardMatrix::clear_row(uint32_t from, const uint32_t *columns, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    size_t first = column_mask(columns, count, 0, mask_);
+    row_kernels().clear(reach_.data() + from * words_ + first, mask_.data(), mask_.size());
+    parent_.erase(from, columns, count);
+}
 
 HashMatrix::HashMatrix(size_t n) : n_(n) {}
 bool HashMatrix::reach(uint32_t from, uint32_t to) const
@@ -40,79 +312,350 @@ void HashMatrix::set_parent(uint32_t from, uint32_t to, const Edge *parent) { pa
 size_t HashMatrix::size() const { return n_; }
 size_t HashMatrix::capacity() const { return n_ * n_ * (sizeof(bool) + sizeof(Edge *)); } // to-fix
 
-CSRMatrix::CSRMatrix(const vector<Vertex> &vertices) : vertices_(vertices), n_(vertices.size())
+CSRMatrix::CSRMatrix(const vector<Vertex> &vertices, bool witness) : n_(vertices.size()), parent_(vertices.size(), witness)
 {
-    row_ptr_.resize(n_ + 1, 0);
+    word_ptr_.resize(n_ + 1, 0);
+    starts_.resize(n_);
+    ends_.resize(n_);
+    lefts_.resize(n_);
+    rights_.resize(n_);
 
-    size_t size = 0;
+    size_t words = 0;
     for (const Vertex &v : vertices)
     {
-        row_ptr_[v.index()] = size;
-        size += v.right() - v.left();
+        word_ptr_[v.index()] = words;
+        starts_[v.index()] = v.start();
+        ends_[v.index()] = v.end();
+        lefts_[v.index()] = v.left();
+        rights_[v.index()] = v.right();
+        words += (v.right() - v.left() + 63) / 64;
     }
-    reach_.resize(size, false);
-    parent_.resize(size, nullptr);
+    word_ptr_[n_] = words;
+    reach_.resize(words, 0);
 }
 
 bool CSRMatrix::reach(uint32_t from, uint32_t to) const
 {
-    if (vertices_[from].end() <= vertices_[to].start())
+    if (ends_[from] <= starts_[to])
     {
         return true;
     }
-    else if (vertices_[to].end() <= vertices_[from].start())
+    else if (ends_[to] <= starts_[from])
     {
         return false;
     }
-    int row_start = row_ptr_[from];
-    int offset = to - vertices_[from].left();
-    return reach_[row_start + offset];
+    size_t offset = to - lefts_[from];
+    return (reach_[word_ptr_[from] + offset / 64] >> (offset % 64)) & 1;
 }
 
 void CSRMatrix::set_reach(uint32_t from, uint32_t to, bool is_reachable)
 {
-    int row_start = row_ptr_[from];
-    int offset = to - vertices_[from].left();
-    reach_[row_start + offset] = is_reachable;
+    if (fixed(from, to))
+    {
+        return;
+    }
+    size_t offset = to - lefts_[from];
+    uint64_t bit = uint64_t(1) << (offset % 64);
+    uint64_t &word = reach_[word_ptr_[from] + offset / 64];
+    word = is_reachable ? (word | bit) : (word & ~bit);
 }
 
 const Edge *CSRMatrix::parent(uint32_t from, uint32_t to) const
 {
-    if (vertices_[from].end() <= vertices_[to].start())
+    if (fixed(from, to))
     {
         return nullptr;
     }
-    else if (vertices_[to].end() <= vertices_[from].start())
+    return parent_.get(from, to);
+}
+
+void CSRMatrix::set_parent(uint32_t from, uint32_t to, const Edge *parent)
+{
+    if (fixed(from, to))
     {
-        return nullptr;
+        return;
     }
-    int row_start = row_ptr_[from];
-    int offset = to - vertices_[from].left();
-    return parent_[row_start + offset];
+    parent_.set(from, to, parent);
 }
 
-void CSRMatrix::set_parent(uint32_t from, uint32_t to, const Edge *parent)
+uint64_t CSRMatrix::row_bits(uint32_t from, uint32_t to) const
+{
+    return window_bits(reach_.data() + word_ptr_[from], word_ptr_[from + 1] - word_ptr_[from],
+                       rights_[from] - lefts_[from], int64_t(to) - lefts_[from]);
+}
+
+void CSRMatrix::merge_row(uint32_t to, uint32_t from, uint32_t lo, uint32_t hi, const Edge *parent, vector<Edge> &added)
+{
+    uint32_t left = lefts_[to];
+    // before the window row `to` reads false and keeps nothing
+    for (uint32_t j = lo; j < min(hi, left); ++j)
+    {
+        if (reach(from, j))
+        {
+            added.emplace_back(to, j);
+        }
+    }
+    uint32_t first = max(lo, left);
+    uint32_t last = min(hi, rights_[to]); // after the window it already reads true
+    if (first >= last)
+    {
+        return;
+    }
+    uint64_t *row = reach_.data() + word_ptr_[to];
+    bool witness = parent != nullptr && parent_.enabled();
+    uint32_t id = witness ? parent_.intern(*parent) : 0;
+    auto visit = [&](size_t w, uint64_t bits)
+    {
+        while (bits != 0)
+        {
+            uint32_t k = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            uint32_t col = left + w * 64 + k;
+            added.emplace_back(to, col);
+            if (!fixed(to, col))
+            {
+                row[w] |= uint64_t(1) << k;
+                if (witness)
+                {
+                    parent_.set(to, col, id);
+                }
+            }
+        }
+    };
+
+    // words of row `from` line up with those of row `to` when the windows start 64k apart
+    int64_t shift = int64_t(left) - lefts_[from];
+    int64_t from_words = (rights_[from] - lefts_[from]) / 64; // words holding only stored cells
+    uint64_t gathered[FRESH_CHUNK];
+    size_t w_first = (first - left) / 64;
+    size_t w_last = (last - 1 - left) / 64 + 1;
+    for (size_t w = w_first; w < w_last; w += FRESH_CHUNK)
+    {
+        size_t count = min(w_last - w, FRESH_CHUNK);
+        int64_t src_word = shift / 64 + int64_t(w);
+        const uint64_t *src = gathered;
+        if (shift % 64 == 0 && src_word >= 0 && src_word + int64_t(count) <= from_words)
+        {
+            src = reach_.data() + word_ptr_[from] + src_word;
+        }
+        else
+        {
+            for (size_t k = 0; k < count; ++k)
+            {
+                gathered[k] = row_bits(from, left + (w + k) * 64);
+            }
+        }
+        fresh_words(src, row + w, count,
+                    w == w_first ? low_mask((first - left) % 64) : ~uint64_t(0),
+                    w + count == w_last ? high_mask((last - left) % 64) : ~uint64_t(0),
+                    [&](size_t k, uint64_t bits)
+                    { visit(w + k, bits); });
+    }
+}
+
+void CSRMatrix::fill_row(uint32_t from, uint32_t lo, uint32_t hi)
 {
-    int row_start = row_ptr_[from];
-    int offset = to - vertices_[from].left();
-    parent_[row_start + offset] = parent;
+    uint32_t j = max(lo, lefts_[from]);
+    uint32_t last = min(hi, rights_[from]);
+    // vertices up to `from`, and those starting with it, may have ended before it started
+    for (; j < last && (j <= from || starts_[j] <= starts_[from]); ++j)
+    {
+        set_reach(from, j, true);
+    }
+    uint64_t *row = reach_.data() + word_ptr_[from];
+    while (j < last)
+    {
+        uint32_t b = j - lefts_[from];
+        uint32_t shift = b % 64;
+        uint32_t count = min<uint32_t>(64 - shift, last - j);
+        row[b / 64] |= (count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1) << shift;
+        j += count;
+    }
+}
+
+void CSRMatrix::clear_row(uint32_t from, const uint32_t *columns, size_t count)
+{
+    // only the window is stored; time order keeps the cells outside it
+    const uint32_t *first = lower_bound(columns, columns + count, lefts_[from]);
+    const uint32_t *last = lower_bound(first, columns + count, rights_[from]);
+    if (first == last)
+    {
+        return;
+    }
+    size_t w = column_mask(first, last - first, lefts_[from], mask_);
+    row_kernels().clear(reach_.data() + word_ptr_[from] + w, mask_.data(), mask_.size());
+    parent_.erase(from, first, last - first);
 }
 
 size_t CSRMatrix::size() const { return n_; }
-size_t CSRMatrix::capacity() const { return sizeof(reach_) + sizeof(parent_) + sizeof(row_ptr_); }
+size_t CSRMatrix::capacity() const { return reach_.size() * sizeof(uint64_t) + parent_.capacity(); }
+//////////////////////////////////////////////////////////////////////////////////////////
+void ReachabilityMatrix::merge_row(uint32_t to, uint32_t from, uint32_t lo, uint32_t hi, const Edge *parent, vector<Edge> &added)
+{
+    for (uint32_t j = lo; j < hi; ++j)
+    {
+        if (reach(from, j) && !reach(to, j))
+        {
+            set_reach(to, j, true);
+            added.emplace_back(to, j);
+            if (parent != nullptr)
+            {
+                set_parent(to, j, parent);
+            }
+        }
+    }
+}
+
+void ReachabilityMatrix::fill_row(uint32_t from, uint32_t lo, uint32_t hi)
+{
+    for (uint32_t j = lo; j < hi; ++j)
+    {
+        set_reach(from, j, true);
+    }
+}
+
+void ReachabilityMatrix::clear_row(uint32_t from, const uint32_t *columns, size_t count)
+{
+    for (size_t k = 0; k < count; ++k)
+    {
+        set_reach(from, columns[k], false);
+        set_parent(from, columns[k], nullptr);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
-TransitiveClosure::TransitiveClosure(const vector<Vertex> &vertices, const VerifyOptions &options) : vertices_(vertices), options_(options), n_(vertices.size())
+TransitiveClosure::TransitiveClosure(const vector<Vertex> &vertices, const VerifyOptions &options) : vertices_(vertices), options_(options), n_(vertices.size()), solve_(options.witness)
 {
 }
+static ClosureConstruct closure_construct(const string &name)
+{
+    if (name == "warshall")
+    {
+        return ClosureConstruct::WARSHALL;
+    }
+    else if (name == "italino")
+    {
+        return ClosureConstruct::ITALINO;
+    }
+    else if (name == "italino+")
+    {
+        return ClosureConstruct::ITALINO_OPT;
+    }
+    else if (name == "purdom")
+    {
+        return ClosureConstruct::PURDOM;
+    }
+    else if (name == "purdom+")
+    {
+        return ClosureConstruct::PURDOM_OPT;
+    }
+    return ClosureConstruct::NONE;
+}
+
+static ClosureUpdate closure_update(const string &name)
+{
+    if (name == "warshall")
+    {
+        return ClosureUpdate::WARSHALL;
+    }
+    else if (name == "italino")
+    {
+        return ClosureUpdate::ITALINO;
+    }
+    else if (name == "italino+")
+    {
+        return ClosureUpdate::ITALINO_OPT;
+    }
+    return ClosureUpdate::NONE;
+}
+
 void TransitiveClosure::create()
 {
+    ClosureConstruct construct = closure_construct(options_.construct);
+    ClosureUpdate update = closure_update(options_.update);
+    if (options_.threads > 1)
+    {
+        pool_ = make_unique<WorkerPool>(options_.threads);
+    }
     if (options_.compact)
     {
-        matrix_ = make_unique<CSRMatrix>(vertices_);
+        matrix_ = make_unique<CSRMatrix>(vertices_, options_.witness);
+        bind<CSRMatrix>(construct, update);
     }
     else
     {
-        matrix_ = make_unique<StandardMatrix>(n_);
+        matrix_ = make_unique<StandardMatrix>(n_, options_.witness);
+        bind<StandardMatrix>(construct, update);
+    }
+}
+
+template <typename Matrix>
+void TransitiveClosure::bind(ClosureConstruct construct, ClosureUpdate update)
+{
+    // indexed by the enum values
+    static const ConstructFn constructs[] = {
+        &TransitiveClosure::construct_with<Matrix, ClosureConstruct::NONE>,
+        &TransitiveClosure::construct_with<Matrix, ClosureConstruct::WARSHALL>,
+        &TransitiveClosure::construct_with<Matrix, ClosureConstruct::ITALINO>,
+        &TransitiveClosure::construct_with<Matrix, ClosureConstruct::ITALINO_OPT>,
+        &TransitiveClosure::construct_with<Matrix, ClosureConstruct::PURDOM>,
+        &TransitiveClosure::construct_with<Matrix, ClosureConstruct::PURDOM_OPT>,
+    };
+    static const InsertFn inserts[] = {
+        &TransitiveClosure::insert_with<Matrix, ClosureUpdate::NONE>,
+        &TransitiveClosure::insert_with<Matrix, ClosureUpdate::WARSHALL>,
+        &TransitiveClosure::insert_with<Matrix, ClosureUpdate::ITALINO>,
+        &TransitiveClosure::insert_with<Matrix, ClosureUpdate::ITALINO_OPT>,
+    };
+    construct_ = constructs[static_cast<size_t>(construct)];
+    insert_ = inserts[static_cast<size_t>(update)];
+}
+
+template <typename Matrix, ClosureConstruct C>
+void TransitiveClosure::construct_with(const unordered_set<Edge> &edges, const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
+{
+    Matrix &matrix = static_cast<Matrix &>(*matrix_);
+    if constexpr (C == ClosureConstruct::WARSHALL)
+    {
+        warshall(matrix, edges);
+    }
+    else if constexpr (C == ClosureConstruct::ITALINO)
+    {
+        italino(matrix, edges);
+    }
+    else if constexpr (C == ClosureConstruct::ITALINO_OPT)
+    {
+        italino_opt(matrix, edges);
+    }
+    else if constexpr (C == ClosureConstruct::PURDOM)
+    {
+        purdom(matrix, adjacency);
+    }
+    else if constexpr (C == ClosureConstruct::PURDOM_OPT)
+    {
+        purdom_opt(matrix, adjacency);
+    }
+}
+
+template <typename Matrix, ClosureUpdate U>
+vector<Edge> TransitiveClosure::insert_with(const Edge &e)
+{
+    Matrix &matrix = static_cast<Matrix &>(*matrix_);
+    if constexpr (U == ClosureUpdate::WARSHALL)
+    {
+        return warshall(matrix, e);
+    }
+    else if constexpr (U == ClosureUpdate::ITALINO)
+    {
+        return italino(matrix, e);
+    }
+    else if constexpr (U == ClosureUpdate::ITALINO_OPT)
+    {
+        return italino_opt(matrix, e);
+    }
+    else
+    {
+        return vector<Edge>();
     }
 }
 
@@ -145,317 +688,335 @@ vector<::Edge> TransitiveClosure::path(uint32_t from, uint32_t to) const
 
 vector<Edge> TransitiveClosure::insert(const Edge &e)
 {
-
-    if (options_.update == "warshall")
+    vector<Edge> changes = (this->*insert_)(e);
+    if (!epochs_.empty())
     {
-        return warshall(e);
+        undo_.insert(undo_.end(), changes.begin(), changes.end());
     }
-    else if (options_.update == "italino")
-    {
-        return italino(e);
-    }
-    else if (options_.update == "italino+")
-    {
-        return italino_opt(e);
-    }
-    vector<Edge> r;
-    return r;
+    return changes;
 }
 
 void TransitiveClosure::construct(const unordered_set<::Edge> &edges, const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
 {
-    if (options_.construct == "warshall")
-    {
-        warshall(edges);
-    }
-    else if (options_.construct == "italino")
-    {
-        italino(edges);
-    }
-    else if (options_.construct == "italino+")
-    {
-        italino_opt(edges);
-    }
-    else if (options_.construct == "purdom")
-    {
-        purdom(adjacency);
-    }
-    else if (options_.construct == "purdom+")
-    {
-        purdom_opt(adjacency);
-    }
+    (this->*construct_)(edges, adjacency);
 }
 
-void TransitiveClosure::warshall(const unordered_set<Edge> &edges)
+template <typename Matrix>
+void TransitiveClosure::warshall(Matrix &matrix, const unordered_set<Edge> &edges)
 {
     for (const Edge &e : edges)
     {
-        if (!reach(e.from(), e.to()))
+        if (!matrix.reach(e.from(), e.to()))
         {
-            set_reach(e.from(), e.to(), true);
+            matrix.set_reach(e.from(), e.to(), true);
         }
-        if (reach(e.to(), e.from()))
+        if (matrix.reach(e.to(), e.from()))
         {
             throw SerializableException("warshall:cycle");
         }
     }
+    vector<Edge> added;
     for (size_t k = 0; k < n_; k++)
     {
         for (size_t i = 0; i < n_; i++)
         {
-            for (size_t j = 0; j < n_; j++)
+            if (matrix.reach(i, k))
             {
-                if (reach(i, k) && reach(k, j) && !reach(i, j))
-                {
-                    set_reach(i, j, true);
-                }
+                matrix.merge_row(i, k, 0, n_, nullptr, added);
+                added.clear();
             }
         }
     }
 }
 
-vector<Edge> TransitiveClosure::warshall(const Edge &e)
+template <typename Matrix>
+vector<Edge> TransitiveClosure::warshall(Matrix &matrix, const Edge &e)
 {
     vector<Edge> record;
-    if (reach(e.from(), e.to()))
+    if (matrix.reach(e.from(), e.to()))
     {
-        set_reach(e.from(), e.to(), true);
+        matrix.set_reach(e.from(), e.to(), true);
     }
     for (size_t k = 0; k < n_; k++)
     {
         for (size_t i = 0; i < n_; i++)
         {
-            for (size_t j = 0; j < n_; j++)
+            if (matrix.reach(i, k))
             {
-                if (reach(i, k) && reach(k, j) && !reach(i, j))
-                {
-                    set_reach(i, j, true);
-                    record.push_back(Edge(i, j));
-                }
+                matrix.merge_row(i, k, 0, n_, nullptr, record);
             }
         }
     }
     return record;
 }
 
-vector<Edge> TransitiveClosure::italino(const Edge &e)
+template <typename Matrix>
+vector<Edge> TransitiveClosure::italino(Matrix &matrix, const Edge &e)
 {
     vector<Edge> record;
-    if (!reach(e.from(), e.to()))
+    if (!matrix.reach(e.from(), e.to()))
     {
         for (uint32_t i = 0; i < n_; ++i)
         {
-            if (reach(i, e.from()) && !reach(i, e.to()))
+            if (matrix.reach(i, e.from()) && !matrix.reach(i, e.to()))
             {
-                for (uint32_t j = 0; j < n_; ++j)
-                {
-                    if (reach(e.to(), j) && !reach(i, j))
-                    {
-                        set_reach(i, j, true);
-                        record.emplace_back(i, j);
-                        if (solve_)
-                        {
-                            set_parent(i, j, &e);
-                        }
-                    }
-                }
+                matrix.merge_row(i, e.to(), 0, n_, solve_ ? &e : nullptr, record);
             }
         }
     }
     return record;
 }
 
-void TransitiveClosure::italino(const unordered_set<Edge> &edges)
+template <typename Matrix>
+void TransitiveClosure::italino(Matrix &matrix, const unordered_set<Edge> &edges)
 {
     for (const Edge &e : edges)
     {
-        if (reach(e.to(), e.from()))
+        if (matrix.reach(e.to(), e.from()))
         {
             throw SerializableException("italino:cycle");
         }
-        italino(e);
+        italino(matrix, e);
     }
 }
 
-void TransitiveClosure::italino_opt(const unordered_set<Edge> &edges)
+template <typename Matrix>
+void TransitiveClosure::italino_opt(Matrix &matrix, const unordered_set<Edge> &edges)
 {
     for (const Edge &e : edges)
     {
-        italino_opt(e);
+        italino_opt(matrix, e);
     }
 }
 
-vector<Edge> TransitiveClosure::italino_opt(const Edge &e)
+template <typename Matrix>
+vector<Edge> TransitiveClosure::italino_opt(Matrix &matrix, const Edge &e)
 {
     vector<Edge> record;
     const Vertex &s = vertices_[e.from()];
     const Vertex &t = vertices_[e.to()];
 
-    if (!reach(e.from(), e.to()))
+    if (!matrix.reach(e.from(), e.to()))
     {
         uint32_t u_left = t.left();
         uint32_t u_right = min(s.right(), t.right());
-        for (uint32_t i = u_left; i < u_right; ++i)
+        // rows only read row e.to() and write themselves, so any split of the range works
+        auto update = [&](uint32_t first, uint32_t last, vector<Edge> &added)
         {
-            if (reach(i, e.from()) && !reach(i, e.to()))
+            for (uint32_t i = first; i < last; ++i)
             {
-                const Vertex &u = vertices_[i];
-                uint32_t v_left = max(max(u.left(), s.left()), t.left());
-                uint32_t v_right = min(u.right(), s.right());
-                for (uint32_t j = v_left; j < v_right; ++j)
+                if (matrix.reach(i, e.from()) && !matrix.reach(i, e.to()))
                 {
-                    if (reach(e.to(), j) && !reach(i, j))
-                    {
-                        set_reach(i, j, true);
-                        record.emplace_back(i, j);
-                        if (solve_)
-                        {
-                            set_parent(i, j, &e);
-                        }
-                    }
+                    const Vertex &u = vertices_[i];
+                    uint32_t v_left = max(max(u.left(), s.left()), t.left());
+                    uint32_t v_right = min(u.right(), s.right());
+                    matrix.merge_row(i, e.to(), v_left, v_right, solve_ ? &e : nullptr, added);
                 }
             }
+        };
+        size_t rows = u_right > u_left ? u_right - u_left : 0;
+        size_t cols = s.right() > t.left() ? s.right() - t.left() : 0;
+        if (pool_ && rows >= 2 * PARALLEL_GRAIN && rows * (cols / 64 + 1) >= PARALLEL_WORDS)
+        {
+            // fixed blocks appended in row order, so the record matches the sequential one
+            size_t blocks = min(rows / PARALLEL_GRAIN, pool_->size() * 8);
+            vector<vector<Edge>> added(blocks);
+            pool_->run(blocks, 1, [&](size_t b)
+                       { update(u_left + rows * b / blocks, u_left + rows * (b + 1) / blocks, added[b]); });
+            for (const vector<Edge> &block : added)
+            {
+                record.insert(record.end(), block.begin(), block.end());
+            }
+        }
+        else
+        {
+            update(u_left, u_right, record);
         }
     }
     return record;
 }
 
-void TransitiveClosure::purdom(const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
+template <typename Matrix>
+void TransitiveClosure::purdom(Matrix &matrix, const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
 {
     queue<uint32_t> rev_topo_order;
-    vector<State> states(n_, State::UNVISITED);
-    for (uint32_t i = 0; i < n_; ++i)
+    topological_sort(adjacency, false, rev_topo_order, "purdom");
+
+    // Descendants of each vertex over its window only, read like a CSR row: zeros
+    // before the window, ones after it. A row is freed once every predecessor has
+    // merged it, so memory follows the windows still waiting to be read.
+    vector<uint32_t> pending(n_, 0);
+    for (const auto &entry : adjacency)
     {
-        if (states[i] == State::UNVISITED)
+        for (uint32_t s : entry.second)
         {
-            if (dfs(i, states, rev_topo_order, adjacency))
-            {
-                throw SerializableException("purdom:cycle.");
-            }
+            ++pending[s];
         }
     }
-
-    unordered_map<uint32_t, bitset<MAX_VERTICES>> descendants;
+    vector<vector<uint64_t>> descendants(n_);
     while (!rev_topo_order.empty())
     {
         uint32_t i = rev_topo_order.front();
         rev_topo_order.pop();
+        uint32_t left = vertices_[i].left();
+        uint32_t right = vertices_[i].right();
+        vector<uint64_t> &row = descendants[i];
+        row.assign((right - left + 63) / 64, 0);
         auto it = adjacency.find(i);
         if (it != adjacency.end())
         {
             const unordered_set<uint32_t> &succs = it->second;
             for (uint32_t s : succs)
             {
-                descendants[i] |= descendants[s];
+                const Vertex &v = vertices_[s];
+                merge_window(row.data(), row.size(), int64_t(left) - v.left(), descendants[s].data(), descendants[s].size(), v.right() - v.left());
+                if (--pending[s] == 0)
+                {
+                    vector<uint64_t>().swap(descendants[s]);
+                }
             }
         }
-        descendants[i].set(i);
+        row[(i - left) / 64] |= uint64_t(1) << ((i - left) % 64);
+        row.back() &= high_mask((right - left) % 64);
 
-        for (uint32_t j = vertices_[i].left(); j < vertices_[i].right(); ++j)
+        for (size_t w = 0; w < row.size(); ++w)
         {
-            if (descendants[i][j])
+            for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1)
             {
-                set_reach(i, j, true);
+                matrix.set_reach(i, left + w * 64 + __builtin_ctzll(bits), true);
             }
         }
+        if (pending[i] == 0)
+        {
+            vector<uint64_t>().swap(row);
+        }
     }
 }
 
-bool TransitiveClosure::dfs(uint32_t i, vector<State> &states, queue<uint32_t> &rev_topo_order, const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
+void TransitiveClosure::topological_sort(const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency, bool window, queue<uint32_t> &rev_topo_order, const string &strategy)
 {
-    states[i] = State::VISITING;
-    auto it = adjacency.find(i);
-    if (it != adjacency.end())
+    // one frame per vertex on the DFS path: its successors are the adjacency set,
+    // then with `window` the vertices from its right bound on
+    struct Frame
+    {
+        uint32_t vertex;
+        unordered_set<uint32_t>::const_iterator next;
+        unordered_set<uint32_t>::const_iterator end;
+        uint32_t j;
+    };
+    static const unordered_set<uint32_t> none;
+
+    vector<State> states(n_, State::UNVISITED); // VISITING until its component is popped
+    vector<uint32_t> index(n_);
+    vector<uint32_t> low(n_);
+    vector<uint32_t> component;
+    vector<Frame> path;
+    uint32_t counter = 0;
+    uint32_t visited = n_ - 1; // with `window`, later vertices are ordered already
+    vector<Edge> cycle;        // closed by the first edge back onto the path
+
+    auto open = [&](uint32_t v)
     {
-        const unordered_set<uint32_t> &succs = it->second;
-        for (uint32_t s : succs)
+        states[v] = State::VISITING;
+        index[v] = low[v] = counter++;
+        component.push_back(v);
+        auto it = adjacency.find(v);
+        const unordered_set<uint32_t> &succs = it != adjacency.end() ? it->second : none;
+        path.push_back({v, succs.begin(), succs.end(), vertices_[v].right()});
+    };
+    auto next = [&](Frame &f, uint32_t &s)
+    {
+        if (f.next != f.end)
         {
-            if (states[s] == State::UNVISITED)
-            {
-                if (dfs(s, states, rev_topo_order, adjacency))
-                {
-                    return true;
-                }
-            }
-            else if (states[s] == State::VISITING)
-            {
-                return true;
-            }
+            s = *f.next++;
+            return true;
         }
-    }
-    states[i] = State::VISITED;
-    rev_topo_order.push(i);
-    return false;
-}
+        if (window && f.j < visited)
+        {
+            s = f.j++;
+            return true;
+        }
+        return false;
+    };
 
-bool TransitiveClosure::dfs_opt(uint32_t i, vector<State> &states, queue<uint32_t> &rev_topo_order, uint32_t *visited, const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
-{
-    assert(i < n_);
-    states[i] = State::VISITING;
-    auto it = adjacency.find(i);
-    if (it != adjacency.end())
+    for (uint32_t root = 0; root < n_; ++root)
     {
-        const unordered_set<uint32_t> &succs = it->second;
-        for (uint32_t s : succs)
+        if (states[root] != State::UNVISITED)
+        {
+            continue;
+        }
+        open(root);
+        while (!path.empty())
         {
-            assert(s < n_);
-            if (states[s] == State::UNVISITED)
+            Frame &f = path.back();
+            uint32_t s;
+            if (next(f, s))
             {
-                if (dfs_opt(s, states, rev_topo_order, visited, adjacency))
+                if (states[s] == State::UNVISITED)
                 {
-                    return true;
+                    open(s);
                 }
-                *visited = min(*visited, vertices_[s].right());
-            }
-            else if (states[s] == State::VISITING)
-            {
-                return true;
+                else if (states[s] == State::VISITING)
+                {
+                    low[f.vertex] = min(low[f.vertex], index[s]);
+                    if (cycle.empty())
+                    {
+                        // before any cycle every finished vertex has been popped, so s is on the path
+                        size_t k = path.size() - 1;
+                        while (path[k].vertex != s)
+                        {
+                            --k;
+                        }
+                        for (; k + 1 < path.size(); ++k)
+                        {
+                            cycle.emplace_back(path[k].vertex, path[k + 1].vertex);
+                        }
+                        cycle.emplace_back(f.vertex, s);
+                    }
+                }
+                continue;
             }
-        }
-    }
-    if (vertices_[i].right() < *visited)
-    {
-        for (uint32_t j = vertices_[i].right(); j < *visited; ++j)
-        {
-            assert(j < n_);
-            if (states[j] == State::UNVISITED)
+
+            uint32_t v = f.vertex;
+            path.pop_back();
+            if (!path.empty())
             {
-                if (dfs_opt(j, states, rev_topo_order, visited, adjacency))
+                low[path.back().vertex] = min(low[path.back().vertex], low[v]);
+                if (window)
                 {
-                    return true;
+                    visited = min(visited, vertices_[v].right());
                 }
-                *visited = min(*visited, vertices_[j].right());
             }
-            else if (states[j] == State::VISITING)
+            if (low[v] != index[v])
+            {
+                continue;
+            }
+            // v roots a strongly connected component
+            size_t size = 0;
+            bool closes = false;
+            uint32_t w;
+            do
+            {
+                w = component.back();
+                component.pop_back();
+                states[w] = State::VISITED;
+                closes = closes || (!cycle.empty() && w == cycle.front().from());
+                ++size;
+            } while (w != v);
+            if (closes)
             {
-                return true;
+                throw DependencyCycle(strategy, cycle, size, vertices_);
             }
+            rev_topo_order.push(v);
         }
     }
-    assert(i < n_);
-    states[i] = State::VISITED;
-    rev_topo_order.push(i);
-    return false;
 }
 
-void TransitiveClosure::purdom_opt(const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
+template <typename Matrix>
+void TransitiveClosure::purdom_opt(Matrix &matrix, const unordered_map<uint32_t, unordered_set<uint32_t>> &adjacency)
 {
     queue<uint32_t> rev_topo_order;
-    vector<State> states_map(n_, State::UNVISITED);
-
-    //  topological sort
-    uint32_t visited = n_ - 1;
-    for (uint32_t i = 0; i < n_; ++i)
-    {
-        if (states_map[i] == State::UNVISITED)
-        {
-            if (dfs_opt(i, states_map, rev_topo_order, &visited, adjacency))
-            {
-                throw SerializableException("purdom_opt:cycle.");
-            }
-        }
-    }
-    states_map.clear();
+    topological_sort(adjacency, true, rev_topo_order, "purdom_opt");
     // merge
     vector<Descendant> descendants;
     descendants.reserve(n_);
@@ -464,50 +1025,117 @@ void TransitiveClosure::purdom_opt(const unordered_map<uint32_t, unordered_set<u
         descendants.emplace_back(i, vertices_[i].right());
     }
 
-    while (!rev_topo_order.empty())
+    // vertices merged into i: its successors, and those starting in the window after it ends
+    auto for_each_source = [&](uint32_t i, auto &&visit)
     {
-        uint32_t i = rev_topo_order.front();
-        rev_topo_order.pop();
         auto it = adjacency.find(i);
         if (it != adjacency.end())
         {
-            const unordered_set<uint32_t> &succs = it->second;
-            for (uint32_t j : succs)
+            for (uint32_t j : it->second)
             {
-                if (descendants[j].s()[0] < descendants[i].d())
-                {
-                    descendants[i].merge(descendants[j]);
-                }
+                visit(j);
             }
         }
         if (vertices_[i].right() != n_)
         {
             for (uint32_t j = vertices_[i].right(); j < vertices_[vertices_[i].right()].right(); ++j)
             {
-                if (descendants[j].s()[0] < descendants[i].d())
-                {
-                    descendants[i].merge(descendants[j]);
-                }
+                visit(j);
             }
         }
+    };
+    auto merge = [&](uint32_t i)
+    {
+        for_each_source(i, [&](uint32_t j)
+                        {
+                            if (descendants[j].s()[0] < descendants[i].d())
+                            {
+                                descendants[i].merge(descendants[j]);
+                            } });
         for (uint32_t j : descendants[i].s())
         {
-            set_reach(i, j, true);
+            matrix.set_reach(i, j, true);
         }
-        for (uint32_t j = descendants[i].d(); j < vertices_[i].right(); ++j)
+        matrix.fill_row(i, descendants[i].d(), vertices_[i].right());
+    };
+
+    if (!pool_)
+    {
+        while (!rev_topo_order.empty())
+        {
+            merge(rev_topo_order.front());
+            rev_topo_order.pop();
+        }
+        return;
+    }
+
+    // Level sets: a vertex goes one level above every source merged before it in
+    // reverse topological order, and below every source it reads before that source
+    // is merged, so each level reads exactly what the sequential order would.
+    vector<uint32_t> level(n_, 0);
+    vector<bool> merged(n_, false);
+    vector<vector<uint32_t>> levels;
+    while (!rev_topo_order.empty())
+    {
+        uint32_t i = rev_topo_order.front();
+        rev_topo_order.pop();
+        uint32_t l = level[i];
+        for_each_source(i, [&](uint32_t j)
+                        {
+                            if (merged[j])
+                            {
+                                l = max(l, level[j] + 1);
+                            } });
+        for_each_source(i, [&](uint32_t j)
+                        {
+                            if (!merged[j])
+                            {
+                                level[j] = max(level[j], l + 1);
+                            } });
+        level[i] = l;
+        merged[i] = true;
+        if (levels.size() <= l)
         {
-            set_reach(i, j, true);
+            levels.resize(l + 1);
         }
+        levels[l].push_back(i);
+    }
+    // rows of one level are disjoint, and so are their descendant lists
+    for (const vector<uint32_t> &vs : levels)
+    {
+        pool_->run(vs.size(), PARALLEL_GRAIN, [&](size_t k)
+                   { merge(vs[k]); });
     }
 }
 
-void TransitiveClosure::backtrace(const vector<Edge> &edges)
+size_t TransitiveClosure::checkpoint()
 {
-    for (const Edge &e : edges)
+    epochs_.push_back(undo_.size());
+    return epochs_.size() - 1;
+}
+
+void TransitiveClosure::rollback(size_t epoch)
+{
+    if (epoch >= epochs_.size())
+    {
+        return;
+    }
+    // group the logged cells by row, columns ascending
+    auto first = undo_.begin() + epochs_[epoch];
+    sort(first, undo_.end(), [](const Edge &a, const Edge &b)
+         { return a.from() != b.from() ? a.from() < b.from() : a.to() < b.to(); });
+    for (auto it = first; it != undo_.end();)
     {
-        set_reach(e.from(), e.to(), false);
-        set_parent(e.from(), e.to(), nullptr);
+        uint32_t from = it->from();
+        undo_columns_.clear();
+        for (; it != undo_.end() && it->from() == from; ++it)
+        {
+            undo_columns_.push_back(it->to());
+        }
+        matrix_->clear_row(from, undo_columns_.data(), undo_columns_.size());
     }
+    undo_.erase(first, undo_.end());
+    epochs_.resize(epoch);
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -5,13 +5,15 @@
 #include <stdexcept>
 #include "graph.h"
 #include "options.h"
+#include "row_kernels.h"
+#include "worker_pool.h"
 
 #include <vector>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
 #include <stdexcept>
 
-#define MAX_VERTICES 100000
-
 enum State
 {
     UNVISITED = 0,
@@ -19,6 +21,25 @@ enum State
     VISITED = 2
 };
 
+// closure strategies, parsed once from VerifyOptions::construct / update
+enum class ClosureConstruct
+{
+    NONE,
+    WARSHALL,
+    ITALINO,
+    ITALINO_OPT,
+    PURDOM,
+    PURDOM_OPT
+};
+
+enum class ClosureUpdate
+{
+    NONE,
+    WARSHALL,
+    ITALINO,
+    ITALINO_OPT
+};
+
 class ReachabilityMatrix
 {
 public:
@@ -29,12 +50,52 @@ public:
     virtual void set_parent(uint32_t from, uint32_t to, const DSG::Edge *parent) = 0;
     virtual size_t size() const = 0;
     virtual size_t capacity() const = 0;
+
+    // reach(to, j) |= reach(from, j) for j in [lo, hi); every newly reachable j is
+    // appended to `added` as (to, j) and gets `parent` unless that is nullptr
+    virtual void merge_row(uint32_t to, uint32_t from, uint32_t lo, uint32_t hi, const DSG::Edge *parent, std::vector<DSG::Edge> &added);
+    // reach(from, j) = true for j in [lo, hi)
+    virtual void fill_row(uint32_t from, uint32_t lo, uint32_t hi);
+    // reach(from, j) = false and no parent, for the `count` ascending columns j
+    virtual void clear_row(uint32_t from, const uint32_t *columns, size_t count);
+};
+
+// Parent edges of the cells that have one, per row as (column, edge id) pairs sorted
+// by column; each distinct edge is stored once and named by a 32-bit id. A disabled
+// store allocates nothing, reads nullptr and drops writes.
+class WitnessStore
+{
+public:
+    WitnessStore(size_t n, bool enabled);
+    bool enabled() const { return enabled_; }
+    const DSG::Edge *get(uint32_t from, uint32_t to) const;
+    void set(uint32_t from, uint32_t to, const DSG::Edge *parent);
+    // id of a copy of `parent`, for set() calls that share one edge; safe to call
+    // from merge_row on several rows at once
+    uint32_t intern(const DSG::Edge &parent);
+    void set(uint32_t from, uint32_t to, uint32_t id);
+    // drops the witnesses of row `from` at the `count` ascending columns
+    void erase(uint32_t from, const uint32_t *columns, size_t count);
+    size_t capacity() const;
+
+private:
+    struct Witness
+    {
+        uint32_t column;
+        uint32_t id;
+    };
+
+    bool enabled_;
+    std::vector<std::vector<Witness>> rows_;
+    std::deque<DSG::Edge> edges_; // id -> edge, stable addresses for get()
+    std::unordered_map<DSG::Edge, uint32_t> ids_;
+    std::mutex intern_mutex_;
 };
 
-class StandardMatrix : public ReachabilityMatrix
+class StandardMatrix final : public ReachabilityMatrix
 {
 public:
-    StandardMatrix(size_t n);
+    StandardMatrix(size_t n, bool witness);
     bool reach(uint32_t from, uint32_t to) const override;
     void set_reach(uint32_t from, uint32_t to, bool is_reachable) override;
     const DSG::Edge *parent(uint32_t from, uint32_t to) const override;
@@ -42,10 +103,16 @@ public:
     size_t size() const override;
     size_t capacity() const override;
 
+    void merge_row(uint32_t to, uint32_t from, uint32_t lo, uint32_t hi, const DSG::Edge *parent, std::vector<DSG::Edge> &added) override;
+    void fill_row(uint32_t from, uint32_t lo, uint32_t hi) override;
+    void clear_row(uint32_t from, const uint32_t *columns, size_t count) override;
+
 private:
     size_t n_;
-    std::vector<std::vector<bool>> reach_;
-    std::vector<std::vector<const DSG::Edge *>> parent_;
+    size_t words_; // words per row
+    std::vector<uint64_t> reach_;
+    WitnessStore parent_;
+    std::vector<uint64_t> mask_; // clear_row scratch
 };
 
 class HashMatrix : public ReachabilityMatrix
@@ -65,10 +132,13 @@ private:
     std::unordered_map<uint32_t, std::unordered_map<uint32_t, const DSG::Edge *>> parent_;
 };
 
-class CSRMatrix : public ReachabilityMatrix
+// Stores only the cells of row i inside [left(i), right(i)); outside that window,
+// and for vertices that ended before row i started, reachability follows from time
+// order. Each row is a bit set starting on a 64-bit word boundary.
+class CSRMatrix final : public ReachabilityMatrix
 {
 public:
-    CSRMatrix(const std::vector<Vertex> &vertices);
+    CSRMatrix(const std::vector<Vertex> &vertices, bool witness);
     bool reach(uint32_t from, uint32_t to) const override;
     void set_reach(uint32_t from, uint32_t to, bool is_reachable) override;
     const DSG::Edge *parent(uint32_t from, uint32_t to) const override;
@@ -76,24 +146,30 @@ public:
     size_t size() const override;
     size_t capacity() const override;
 
+    void merge_row(uint32_t to, uint32_t from, uint32_t lo, uint32_t hi, const DSG::Edge *parent, std::vector<DSG::Edge> &added) override;
+    void fill_row(uint32_t from, uint32_t lo, uint32_t hi) override;
+    void clear_row(uint32_t from, const uint32_t *columns, size_t count) override;
+    // reachability from `from` to the 64 vertices starting at `to`, one per bit
+    uint64_t row_bits(uint32_t from, uint32_t to) const;
+
 private:
-    void checkAndExpand(size_t requiredSize)
+    // true if time order alone decides whether `from` reaches `to`
+    bool fixed(uint32_t from, uint32_t to) const
     {
-        if (reach_.size() < requiredSize)
-        {
-            size_t newSize = std::max(reach_.size() * 2, requiredSize);
-            reach_.resize(newSize, false);
-            parent_.resize(newSize, nullptr);
-        }
+        return ends_[from] <= starts_[to] || ends_[to] <= starts_[from];
     }
 
 private:
-    const std::vector<Vertex> &vertices_;
     size_t n_;
     size_t d_ = 45;
-    std::vector<bool> reach_;
-    std::vector<const DSG::Edge *> parent_;
-    std::vector<uint32_t> row_ptr_;
+    std::vector<uint64_t> starts_; // copies of the vertex fields, to keep lookups off the vertices
+    std::vector<uint64_t> ends_;
+    std::vector<uint32_t> lefts_;
+    std::vector<uint32_t> rights_;
+    std::vector<uint64_t> reach_;
+    WitnessStore parent_;
+    std::vector<size_t> word_ptr_; // row -> first word in reach_
+    std::vector<uint64_t> mask_;   // clear_row scratch
 };
 
 class TransitiveClosure
@@ -108,30 +184,65 @@ public:
     std::vector<DSG::Edge> path(uint32_t from, uint32_t to) const;
     std::vector<DSG::Edge> insert(const DSG::Edge &e);
     void construct(const std::unordered_set<DSG::Edge> &edges, const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &adjacency);
-    void backtrace(const std::vector<DSG::Edge> &edges);
+    // Opens epoch checkpoint(): from now on insert() logs the cells it sets. Epochs
+    // nest and are numbered from 0 up.
+    size_t checkpoint();
+    // Undoes every insert() since checkpoint `epoch` was taken and closes it and all
+    // later epochs, clearing each touched row once; does nothing if it is not open.
+    void rollback(size_t epoch);
 
 private:
-    void warshall(const std::unordered_set<DSG::Edge> &edges);
-    std::vector<DSG::Edge> warshall(const DSG::Edge &edge);
+    using ConstructFn = void (TransitiveClosure::*)(const std::unordered_set<DSG::Edge> &, const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &);
+    using InsertFn = std::vector<DSG::Edge> (TransitiveClosure::*)(const DSG::Edge &);
+
+    // points construct_ and insert_ at the instantiations for Matrix, the concrete type of matrix_
+    template <typename Matrix>
+    void bind(ClosureConstruct construct, ClosureUpdate update);
+    template <typename Matrix, ClosureConstruct C>
+    void construct_with(const std::unordered_set<DSG::Edge> &edges, const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &adjacency);
+    template <typename Matrix, ClosureUpdate U>
+    std::vector<DSG::Edge> insert_with(const DSG::Edge &e);
 
-    void italino(const std::unordered_set<DSG::Edge> &edges);
-    std::vector<DSG::Edge> italino(const DSG::Edge &edge);
+    template <typename Matrix>
+    void warshall(Matrix &matrix, const std::unordered_set<DSG::Edge> &edges);
+    template <typename Matrix>
+    std::vector<DSG::Edge> warshall(Matrix &matrix, const DSG::Edge &edge);
 
-    void italino_opt(const std::unordered_set<DSG::Edge> &edges);
-    std::vector<DSG::Edge> italino_opt(const DSG::Edge &edge);
+    template <typename Matrix>
+    void italino(Matrix &matrix, const std::unordered_set<DSG::Edge> &edges);
+    template <typename Matrix>
+    std::vector<DSG::Edge> italino(Matrix &matrix, const DSG::Edge &edge);
 
-    void purdom(const std::unordered_map<uint32_t,  std::unordered_set<uint32_t>> &adjacency);
-    void purdom_opt(const std::unordered_map<uint32_t,  std::unordered_set<uint32_t>> &adjacency);
+    template <typename Matrix>
+    void italino_opt(Matrix &matrix, const std::unordered_set<DSG::Edge> &edges);
+    template <typename Matrix>
+    std::vector<DSG::Edge> italino_opt(Matrix &matrix, const DSG::Edge &edge);
 
-    bool dfs(uint32_t i, std::vector<State> &states, std::queue<uint32_t> &rev_topo_order, const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &adjacency);
-    bool dfs_opt(uint32_t i, std::vector<State> &states, std::queue<uint32_t> &rev_topo_order,  uint32_t *visited, const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &adjacency);
+    template <typename Matrix>
+    void purdom(Matrix &matrix, const std::unordered_map<uint32_t,  std::unordered_set<uint32_t>> &adjacency);
+    template <typename Matrix>
+    void purdom_opt(Matrix &matrix, const std::unordered_map<uint32_t,  std::unordered_set<uint32_t>> &adjacency);
+
+    // Pushes every vertex to rev_topo_order after its successors, walking `adjacency`
+    // and, with `window`, the vertices starting after each one ends (purdom_opt). Uses
+    // an explicit stack and Tarjan's lowlinks; throws DependencyCycle on a cycle.
+    void topological_sort(const std::unordered_map<uint32_t, std::unordered_set<uint32_t>> &adjacency, bool window, std::queue<uint32_t> &rev_topo_order, const std::string &strategy);
 
 private:
     const std::vector<Vertex> &vertices_;
     const VerifyOptions &options_;
     size_t n_;
     std::unique_ptr<ReachabilityMatrix> matrix_;
+    ConstructFn construct_ = nullptr;
+    InsertFn insert_ = nullptr;
+    std::unique_ptr<WorkerPool> pool_; // only with options_.threads > 1
     bool solve_;
+
+    // undo log: cells set by insert() while an epoch is open, oldest first; both
+    // buffers keep their capacity across rollbacks
+    std::vector<DSG::Edge> undo_;
+    std::vector<size_t> epochs_; // epoch -> undo_.size() when it was opened
+    std::vector<uint32_t> undo_columns_;
 };
 
 class Descendant
@@ -0,0 +1,108 @@
+#include "worker_pool.h"
+#include <algorithm>
+
+using namespace std;
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    for (size_t t = 1; t < threads; ++t)
+    {
+        workers_.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (thread &worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::run(size_t n, size_t grain, const function<void(size_t)> &task)
+{
+    if (workers_.empty() || n < max<size_t>(grain, 2))
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+    {
+        lock_guard<mutex> lock(mutex_);
+        task_ = &task;
+        n_ = n;
+        // several chunks per thread, so uneven tasks still balance
+        chunk_ = max<size_t>(1, n / (size() * 8));
+        next_ = 0;
+        busy_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+    drain();
+
+    unique_lock<mutex> lock(mutex_);
+    done_.wait(lock, [this]()
+               { return busy_ == 0; });
+    task_ = nullptr;
+    if (error_)
+    {
+        exception_ptr error = error_;
+        error_ = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+void WorkerPool::work()
+{
+    size_t seen = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [&]()
+                       { return stop_ || generation_ != seen; });
+            if (stop_)
+            {
+                return;
+            }
+            seen = generation_;
+        }
+        drain();
+        lock_guard<mutex> lock(mutex_);
+        if (--busy_ == 0)
+        {
+            done_.notify_one();
+        }
+    }
+}
+
+void WorkerPool::drain()
+{
+    try
+    {
+        for (size_t begin = next_.fetch_add(chunk_); begin < n_; begin = next_.fetch_add(chunk_))
+        {
+            size_t end = min(begin + chunk_, n_);
+            for (size_t i = begin; i < end; ++i)
+            {
+                (*task_)(i);
+            }
+        }
+    }
+    catch (...)
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (!error_)
+        {
+            error_ = current_exception();
+        }
+        next_ = n_; // the others stop at their next claim
+    }
+}
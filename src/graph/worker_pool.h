@@ -0,0 +1,50 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads for repeated parallel loops. The calling thread joins in,
+// and indices are claimed in chunks from a shared counter, so threads that finish
+// early keep taking work the slower ones have not reached.
+class WorkerPool
+{
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // threads taking part in run(), the caller included
+    size_t size() const { return workers_.size() + 1; }
+    // runs task(i) for every i in [0, n) and returns once all calls have finished;
+    // loops shorter than `grain` run on the calling thread alone
+    void run(size_t n, size_t grain, const std::function<void(size_t)> &task);
+
+private:
+    void work();
+    void drain();
+
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    size_t generation_ = 0;
+    size_t busy_ = 0;
+    bool stop_ = false;
+
+    const std::function<void(size_t)> *task_ = nullptr;
+    size_t n_ = 0;
+    size_t chunk_ = 1;
+    std::atomic<size_t> next_{0};
+    std::exception_ptr error_;
+};
+
+#endif // WORKER_POOL_H
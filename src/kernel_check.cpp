@@ -0,0 +1,24 @@
+#include <iostream>
+#include <vector>
+
+#include "graph/row_kernels.h"
+
+using namespace std;
+
+// Runs the self test on every row kernel variant this CPU supports, not only the
+// one row_kernels() settles on, and exits non-zero if any of them disagrees with
+// the scalar kernels.
+int main()
+{
+    cout << "====================== Row Kernel Check ======================\n";
+    int failed = 0;
+    for (const RowKernels *kernels : supported_row_kernels())
+    {
+        bool passed = row_kernels_self_test(*kernels);
+        failed += passed ? 0 : 1;
+        cout << "  " << kernels->isa << ": " << (passed ? "pass" : "FAIL") << "\n";
+    }
+    cout << "Selected: " << row_kernels().isa << "\n";
+    cout << "===============================================================\n";
+    return failed == 0 ? 0 : 1;
+}
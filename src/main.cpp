@@ -21,9 +21,9 @@ int main(int argc, char *argv[])
     {
         cout << "====================== Usage Instructions ======================\n";
         cout << "Usage:\n";
-        cout << "  " << argv[0] << " <log> <verifier> <time> <compact> <merge> <prune> <construct> <update> <sat>\n";
+        cout << "  " << argv[0] << " <log> <verifier> <time> <compact> <merge> <prune> <construct> <update> <sat> <loader> <threads> <arena> <witness>\n";
         cout << "\nParameters:\n";
-        cout << "  <log>        Path to the directory containing the log files.\n";
+        cout << "  <log>        Path to the directory containing the log files (or a v2 / DBcop history file).\n";
         cout << "  <verifier>   Type of verifier to use. Options are: vbox / leopard\n";
         cout << "  <time>       Timing enabled. Options are: true / false\n";
         cout << "  <compact>    Compaction enabled. Options are: true / false\n";
@@ -32,8 +32,12 @@ int main(int argc, char *argv[])
         cout << "  <construct>  TC construction strategy. Options are: purdom+ / warshall / purdom / italino / italino+ \n";
         cout << "  <update>     TC update strategy. Options are: italino+ / warshall / italino\n";
         cout << "  <sat>        SAT strategy. Options are: vboxsat / monosat / minsat\n";
+        cout << "  <loader>     Log loader backend. Options are: stream / mmap / zlib / v2 / cobra / dbcop\n";
+        cout << "  <threads>    Number of worker threads. Default is 1\n";
+        cout << "  <arena>      Arena allocation of the loaded history. Options are: true / false\n";
+        cout << "  <witness>    Keep the parent edge of closure cells with monosat / minsat. Default is false; vboxsat always keeps them for its conflict explanations\n";
         cout << "\nExample:\n";
-        cout << "  " << argv[0] << " /path/to/logs vbox true true true prune_opt purdom+ italino_opt vboxsat\n";
+        cout << "  " << argv[0] << " /path/to/logs vbox true true true prune_opt purdom+ italino_opt vboxsat mmap 4 true false\n";
         cout << "===============================================================\n";
         return 0;
     }
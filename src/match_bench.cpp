@@ -0,0 +1,129 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "transaction/transaction.h"
+
+using namespace std;
+
+// Times UnitedPredicate::match against the number of range predicates a
+// transaction holds over one field, next to testing the predicates one by one.
+// Predicates are WIDTH values wide and spread over [0, DOMAIN); writes update
+// the field to uniform values in the same domain.
+#define BENCH_FIELD 1
+#define BENCH_WIDTH 50
+#define BENCH_DOMAIN 1000000
+
+struct BenchResult
+{
+    long united_time = 0; // us
+    long linear_time = 0; // us
+    size_t united_hits = 0;
+    size_t linear_hits = 0;
+};
+
+static BenchResult run(uint32_t n_preds, uint32_t n_calls, mt19937 &rng)
+{
+    uniform_int_distribution<uint32_t> value(0, BENCH_DOMAIN - 1);
+    OperatorStore ops;
+    ops.reserve(n_preds + n_calls);
+    for (uint32_t i = 0; i < n_preds; ++i)
+    {
+        uint32_t left = value(rng);
+        ops.append_predicate(i, 0, 0, Predicate(BENCH_FIELD, left, left + BENCH_WIDTH - 1, {}, {}, {}));
+    }
+    for (uint32_t i = 0; i < n_calls; ++i)
+    {
+        ops.append_write(i, 0, 0, i, BENCH_FIELD, value(rng));
+    }
+
+    vector<const Predicate *> preds;
+    UnitedPredicate u_pred;
+    for (uint32_t k = 0; k < n_preds; ++k)
+    {
+        preds.push_back(&ops.predicate(k));
+        u_pred.add(preds.back());
+    }
+    vector<Write> writes;
+    writes.reserve(n_calls);
+    for (uint32_t k = n_preds; k < ops.size(); ++k)
+    {
+        writes.push_back(ops.write(k));
+    }
+
+    BenchResult result;
+    auto start = chrono::high_resolution_clock::now();
+    for (const Write &write : writes)
+    {
+        result.united_hits += u_pred.match(&write) ? 1 : 0;
+    }
+    auto end = chrono::high_resolution_clock::now();
+    result.united_time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+
+    start = chrono::high_resolution_clock::now();
+    for (const Write &write : writes)
+    {
+        for (const Predicate *p : preds)
+        {
+            if (p->match(&write))
+            {
+                ++result.linear_hits;
+                break;
+            }
+        }
+    }
+    end = chrono::high_resolution_clock::now();
+    result.linear_time = chrono::duration_cast<chrono::microseconds>(end - start).count();
+    return result;
+}
+
+static double throughput(uint32_t n_calls, long time)
+{
+    return time > 0 ? static_cast<double>(n_calls) / time : 0.0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && string(argv[1]) == "-h")
+    {
+        cout << "====================== Usage Instructions ======================\n";
+        cout << "Usage:\n";
+        cout << "  " << argv[0] << " [calls] [predicates ...]\n";
+        cout << "\nParameters:\n";
+        cout << "  [calls]       match() calls per run. Default is 1000000\n";
+        cout << "  [predicates]  Predicates per transaction, one run each. Default is 1 4 16 64 256 1024\n";
+        cout << "\nExample:\n";
+        cout << "  " << argv[0] << " 1000000 16 256 4096\n";
+        cout << "===============================================================\n";
+        return 0;
+    }
+    uint32_t n_calls = argc > 1 ? stoul(argv[1]) : 1000000;
+    vector<uint32_t> counts;
+    for (int i = 2; i < argc; ++i)
+    {
+        counts.push_back(stoul(argv[i]));
+    }
+    if (counts.empty())
+    {
+        counts = {1, 4, 16, 64, 256, 1024};
+    }
+
+    mt19937 rng(20240101);
+    bool agree = true;
+    cout << "====================== Match Benchmark ======================\n";
+    cout << "Match Calls per Run:        " << n_calls << "\n";
+    cout << "Predicate Width:            " << BENCH_WIDTH << " of " << BENCH_DOMAIN << "\n";
+    for (uint32_t n_preds : counts)
+    {
+        BenchResult result = run(n_preds, n_calls, rng);
+        agree = agree && result.united_hits == result.linear_hits;
+        cout << "  Predicates: " << n_preds << "\n";
+        cout << "    United Match Throughput:  " << throughput(n_calls, result.united_time) << " Mmatch/s\n";
+        cout << "    Linear Match Throughput:  " << throughput(n_calls, result.linear_time) << " Mmatch/s\n";
+        cout << "    Hits:                     " << result.united_hits << (result.united_hits == result.linear_hits ? "" : " (MISMATCH)") << "\n";
+    }
+    cout << "===============================================================\n";
+    return agree ? 0 : 1;
+}
@@ -16,6 +16,10 @@ public:
     std::string construct = "purdom+";
     std::string update = "italino+";
     std::string sat = "vboxsat";
+    std::string loader = "stream";
+    int threads = 1;
+    bool arena = false;
+    bool witness = false;
 
     bool collect = false;
 
@@ -41,6 +45,16 @@ public:
             update = argv[8];
         if (argc > 9)
             sat = argv[9];
+        if (argc > 10)
+            loader = argv[10];
+        if (argc > 11)
+            threads = std::stoi(argv[11]);
+        if (argc > 12)
+            arena = (std::string(argv[12]) == "true");
+        if (argc > 13)
+            witness = (std::string(argv[13]) == "true");
+        // vboxsat explains conflicts through closure paths, which need the parent edges
+        witness = witness || sat == "vboxsat";
         collect = (sat == "monosat" || sat == "minisat" || construct == "purdom" || construct == "italino"||construct == "italino+");
     }
     void print() const
@@ -57,6 +71,10 @@ public:
             std::cout << "TC Construction Strategy: " << construct << "\n";
             std::cout << "TC Update Strategy:       " << update << "\n";
             std::cout << "SAT Strategy:             " << sat << "\n";
+            std::cout << "Log Loader:               " << loader << "\n";
+            std::cout << "Threads:                  " << threads << "\n";
+            std::cout << "Arena Allocation:         " << (arena ? "true" : "false") << "\n";
+            std::cout << "Closure Witnesses:        " << (witness ? "true" : "false") << "\n";
             std::cout << "===========================================================\n";
         }
         else if (verifier == "leopard")
@@ -64,6 +82,9 @@ public:
             std::cout << "====================== Verify Options ======================\n";
             std::cout << "Log Path:                 " << log << "\n";
             std::cout << "Verifier Type:            " << verifier << "\n";
+            std::cout << "Log Loader:               " << loader << "\n";
+            std::cout << "Threads:                  " << threads << "\n";
+            std::cout << "Arena Allocation:         " << (arena ? "true" : "false") << "\n";
         }
         else
         {
@@ -120,7 +120,6 @@ void VboxSolver::v_propagate(unordered_set<ConstraintVar *> &reason)
                 for (const ::Edge &changedEdge : changes)
                 {
                     ::Edge reject(changedEdge.to(), changedEdge.from());
-                    record_[decision_level()].push_back(changedEdge);
 
                     // auto item_it = item_directions_.find(reject);
                     // if (item_it != item_directions_.end())
@@ -249,10 +248,9 @@ void VboxSolver::v_backtrace(int bk_level)
         for (int c = decisionLevel() - 1; c >= bk_level; c--)
         {
             v_trail_lim_.pop_back();
-            auto &record = record_.back();
-            record_.pop_back();
-            closure_->backtrace(record);
         }
+        // epoch k was opened with decision level k + 1
+        closure_->rollback(bk_level);
     }
 }
 
@@ -262,7 +260,6 @@ bool VboxSolver::check()
     unordered_set<ConstraintVar *> reason;
     while (!unassigned_.empty())
     {
-        record_.push_back(std::vector<DSG::Edge>());
         reason.clear();
         v_propagate(reason);
         if (reason.size() > 0)
@@ -291,6 +288,7 @@ bool VboxSolver::check()
                 return true;
             }
             v_trail_lim_.push_back(v_trail_.size());
+            closure_->checkpoint();
             var = *unassigned_.begin();
             unassigned_.erase(unassigned_.begin());
             bool ass = true;
@@ -49,7 +49,6 @@ private:
     // std::unordered_map<DSG::Edge, std::unordered_set<DSG::Edge>> re_derivations_;
     std::vector<ConstraintVar *> v_trail_;
     size_t v_head_ = 0;
-    std::vector<std::vector<DSG::Edge>> record_;
 };
 
 class MiniSolver
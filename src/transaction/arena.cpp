@@ -0,0 +1,36 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+Arena::Arena(size_t block_size) : block_size_(block_size) {}
+
+void *Arena::allocate(size_t size, size_t align)
+{
+    uintptr_t cur = reinterpret_cast<uintptr_t>(cur_);
+    uintptr_t aligned = (cur + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    if (cur_ == nullptr || aligned + size > reinterpret_cast<uintptr_t>(end_))
+    {
+        size_t n = max(block_size_, size + align);
+        blocks_.emplace_back(new char[n]);
+        bytes_ += n;
+        cur_ = blocks_.back().get();
+        end_ = cur_ + n;
+        cur = reinterpret_cast<uintptr_t>(cur_);
+        aligned = (cur + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    }
+    cur_ = reinterpret_cast<char *>(aligned + size);
+    return reinterpret_cast<void *>(aligned);
+}
+
+size_t Arena::blocks() const { return blocks_.size(); }
+size_t Arena::bytes() const { return bytes_; }
+
+///////////////////////////////////////////////////////////////////////
+
+HistoryAllocator::HistoryAllocator(Arena *arena) : arena_(arena) {}
+
+size_t HistoryAllocator::objects() const { return objects_; }
+size_t HistoryAllocator::object_bytes() const { return object_bytes_; }
+size_t HistoryAllocator::system_allocs() const { return arena_ != nullptr ? arena_->blocks() : objects_; }
+size_t HistoryAllocator::system_bytes() const { return arena_ != nullptr ? arena_->bytes() : object_bytes_; }
@@ -0,0 +1,91 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Bump allocator: everything handed out is released at once when the arena dies.
+class Arena
+{
+public:
+    Arena(size_t block_size = 1 << 20);
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t align);
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    size_t blocks() const;
+    size_t bytes() const;
+
+private:
+    size_t block_size_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char *cur_ = nullptr;
+    char *end_ = nullptr;
+    size_t bytes_ = 0;
+};
+
+// Arena-owned objects are only destroyed; their storage goes away with the arena.
+struct HistoryDeleter
+{
+    bool arena = false;
+
+    template <typename T>
+    void operator()(T *p) const
+    {
+        if (arena)
+        {
+            p->~T();
+        }
+        else
+        {
+            delete p;
+        }
+    }
+};
+
+template <typename T>
+using HistoryPtr = std::unique_ptr<T, HistoryDeleter>;
+
+// Builds history objects on the heap, or in an arena when one is given. The
+// objects built are counted the same way in both modes; the system allocations
+// are one per object on the heap (malloc's own headers not included) and one
+// per block in an arena.
+class HistoryAllocator
+{
+public:
+    HistoryAllocator(Arena *arena = nullptr);
+
+    template <typename T, typename... Args>
+    HistoryPtr<T> make(Args &&...args)
+    {
+        objects_++;
+        object_bytes_ += sizeof(T);
+        if (arena_ != nullptr)
+        {
+            return HistoryPtr<T>(arena_->create<T>(std::forward<Args>(args)...), HistoryDeleter{true});
+        }
+        return HistoryPtr<T>(new T(std::forward<Args>(args)...));
+    }
+
+    size_t objects() const;
+    size_t object_bytes() const;
+    size_t system_allocs() const;
+    size_t system_bytes() const;
+
+private:
+    Arena *arena_;
+    size_t objects_ = 0;
+    size_t object_bytes_ = 0;
+};
+
+#endif // ARENA_H
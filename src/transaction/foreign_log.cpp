@@ -0,0 +1,247 @@
+#include "foreign_log.h"
+#include "log_reader.h"
+#include "session_builder.h"
+#include <endian.h>
+#include <stdexcept>
+using namespace std;
+
+// Wraps a reader of native-order fields for a big-endian log.
+template <typename Reader>
+class BigEndianReader
+{
+public:
+    BigEndianReader(Reader &in) : in_(in) {}
+
+    bool next(char &op) { return in_.next(op); }
+
+    void read(uint64_t &value)
+    {
+        in_.read(value);
+        value = be64toh(value);
+    }
+
+private:
+    Reader &in_;
+};
+
+static uint32_t cobra_id(uint64_t id)
+{
+    if (id == FOREIGN_INIT_ID)
+    {
+        return INIT_TID;
+    }
+    if (id > UINT32_MAX)
+    {
+        throw runtime_error("LOG ERROR: Cobra id out of range");
+    }
+    return id;
+}
+
+void load_cobra(const string &path, Session &session, HistoryAllocator &alloc)
+{
+    MappedFile file(path);
+    if (!file.valid())
+    {
+        return;
+    }
+    MappedReader mapped(file.begin(), file.end());
+    BigEndianReader<MappedReader> in(mapped);
+    SessionBuilder builder(session, alloc);
+    char opType;
+    while (in.next(opType))
+    {
+        uint64_t tid, wid, key, value;
+        switch (opType)
+        {
+        case 'S':
+            in.read(tid);
+            builder.begin(cobra_id(tid), 0, FOREIGN_END_TIME);
+            builder.append('S', 0, 0, FOREIGN_END_TIME);
+            break;
+        case 'C':
+            in.read(tid);
+            builder.commit(0, 0, FOREIGN_END_TIME);
+            break;
+        case 'W':
+        {
+            in.read(wid);
+            in.read(key);
+            in.read(value);
+            PendingOperator &op = builder.append('W', cobra_id(wid), 0, FOREIGN_END_TIME);
+            op.key = key;
+            op.field = 1;
+            op.x = 1;
+        }
+        break;
+        case 'R':
+        {
+            in.read(tid);
+            in.read(wid);
+            in.read(key);
+            in.read(value);
+            PendingOperator &op = builder.append('R', 1, 0, FOREIGN_END_TIME);
+            op.key = key;
+            op.x = cobra_id(tid);
+            op.y = cobra_id(wid);
+        }
+        break;
+        default:
+            throw runtime_error("LOG ERROR: Unknown operation type");
+        }
+    }
+    // only committed transactions are part of a Cobra history
+    if (builder.open())
+    {
+        builder.abort();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////
+
+// bincode 1.x defaults: little-endian, u64 lengths, one byte per bool
+static uint64_t read_length(MappedReader &in)
+{
+    uint64_t n;
+    in.read(n);
+    return n;
+}
+
+static bool read_bool(MappedReader &in)
+{
+    uint8_t b;
+    in.read(b);
+    return b != 0;
+}
+
+static void skip_string(MappedReader &in)
+{
+    for (uint64_t n = read_length(in); n > 0; --n)
+    {
+        uint8_t c;
+        in.read(c);
+    }
+}
+
+static bool is_init(const DbcopTransaction &trx)
+{
+    for (const DbcopEvent &event : trx.events)
+    {
+        if (!event.write || event.value != FOREIGN_INIT_ID)
+        {
+            return false;
+        }
+    }
+    return !trx.events.empty();
+}
+
+DbcopHistory::DbcopHistory(const string &path)
+{
+    MappedFile file(path);
+    if (!file.valid())
+    {
+        return;
+    }
+    MappedReader in(file.begin(), file.end());
+    for (int i = 0; i < 5; ++i) // params: id, n_node, n_variable, n_transaction, n_event
+    {
+        read_length(in);
+    }
+    skip_string(in); // info
+    skip_string(in); // start
+    skip_string(in); // end
+    sessions_.resize(read_length(in));
+    for (vector<DbcopTransaction> &session : sessions_)
+    {
+        session.resize(read_length(in));
+        for (DbcopTransaction &trx : session)
+        {
+            trx.events.resize(read_length(in));
+            for (DbcopEvent &event : trx.events)
+            {
+                event.write = read_bool(in);
+                in.read(event.variable);
+                in.read(event.value);
+                event.success = read_bool(in);
+            }
+            trx.success = read_bool(in);
+        }
+    }
+
+    // number the loaded transactions and writes session by session
+    uint32_t next_tid = INIT_TID + 1, next_oid = INIT_OID + 1;
+    for (vector<DbcopTransaction> &session : sessions_)
+    {
+        for (DbcopTransaction &trx : session)
+        {
+            trx.tid = 0;
+            trx.first_oid = next_oid;
+            if (!trx.success || is_init(trx))
+            {
+                continue;
+            }
+            trx.tid = next_tid++;
+            for (const DbcopEvent &event : trx.events)
+            {
+                if (event.success && event.write)
+                {
+                    writers_[{event.variable, event.value}] = {trx.tid, next_oid++};
+                }
+            }
+        }
+    }
+    valid_ = true;
+}
+
+bool DbcopHistory::valid() const { return valid_; }
+size_t DbcopHistory::sessions() const { return sessions_.size(); }
+
+void DbcopHistory::load_session(size_t i, Session &session, HistoryAllocator &alloc) const
+{
+    SessionBuilder builder(session, alloc);
+    session.trxs.reserve(sessions_[i].size());
+    for (const DbcopTransaction &trx : sessions_[i])
+    {
+        if (trx.tid == 0)
+        {
+            continue;
+        }
+        builder.begin(trx.tid, 0, FOREIGN_END_TIME);
+        builder.append('S', 0, 0, FOREIGN_END_TIME);
+        uint32_t oid = trx.first_oid;
+        for (const DbcopEvent &event : trx.events)
+        {
+            if (!event.success)
+            {
+                continue;
+            }
+            if (event.write)
+            {
+                PendingOperator &op = builder.append('W', oid++, 0, FOREIGN_END_TIME);
+                op.key = event.variable;
+                op.field = 1;
+                op.x = 1;
+                continue;
+            }
+            PendingOperator &op = builder.append('R', 1, 0, FOREIGN_END_TIME);
+            op.key = event.variable;
+            auto writer = writers_.find({event.variable, event.value});
+            if (writer != writers_.end())
+            {
+                op.x = writer->second.first;
+                op.y = writer->second.second;
+            }
+            else if (event.value == FOREIGN_INIT_ID || event.value == 0)
+            {
+                op.x = INIT_TID;
+                op.y = INIT_OID;
+            }
+            else
+            {
+                // written by no loaded transaction: left for the verifier to reject
+                op.x = UINT32_MAX;
+                op.y = UINT32_MAX;
+            }
+        }
+        builder.commit(0, 0, FOREIGN_END_TIME);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef FOREIGN_LOG_H
+#define FOREIGN_LOG_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "transaction/transaction.h"
+
+// Histories recorded for other checkers, loaded without a conversion pass.
+// Neither format carries timestamps: every transaction spans the same
+// [0, FOREIGN_END_TIME] window, as scripts/evaluate.py transform_to_vbox does.
+#define FOREIGN_END_TIME 9999999
+#define FOREIGN_INIT_ID 0xbebeebee
+
+// Cobra (loader "cobra"): one big-endian log per session.
+//   'S' tid u64 | 'C' tid u64 | 'W' wid u64, key u64, value u64
+//   'R' writer tid u64, wid u64, key u64, value u64
+// FOREIGN_INIT_ID stands for the initial transaction / write.
+void load_cobra(const std::string &path, Session &session, HistoryAllocator &alloc);
+
+struct DbcopEvent
+{
+    bool write;
+    uint64_t variable;
+    uint64_t value;
+    bool success;
+};
+
+struct DbcopTransaction
+{
+    std::vector<DbcopEvent> events;
+    bool success;
+    uint32_t tid;        // 0 if the transaction is not loaded
+    uint32_t first_oid;  // oid of its first write
+};
+
+// DBcop (loader "dbcop"): bincode-serialized History, as written by the
+// translator in src/transform. Reads name their write by (variable, value);
+// values are unique per variable. Failed transactions and events are
+// dropped, and a transaction writing FOREIGN_INIT_ID everywhere is taken as
+// the initial one. Reads of a value no loaded transaction wrote point at
+// tid/oid UINT32_MAX.
+class DbcopHistory
+{
+public:
+    DbcopHistory(const std::string &path);
+
+    bool valid() const;
+    size_t sessions() const;
+    void load_session(size_t i, Session &session, HistoryAllocator &alloc) const;
+
+private:
+    struct WriteHash
+    {
+        size_t operator()(const std::pair<uint64_t, uint64_t> &w) const
+        {
+            return std::hash<uint64_t>()(w.first * 0x9e3779b97f4a7c15ULL ^ w.second);
+        }
+    };
+
+    bool valid_ = false;
+    std::vector<std::vector<DbcopTransaction>> sessions_;
+    std::unordered_map<std::pair<uint64_t, uint64_t>, std::pair<uint32_t, uint32_t>, WriteHash> writers_; // (variable, value) -> (tid, oid)
+};
+
+#endif // FOREIGN_LOG_H
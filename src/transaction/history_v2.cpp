@@ -0,0 +1,91 @@
+#include "history_v2.h"
+#include <cstring>
+#include <stdexcept>
+using namespace std;
+
+// true if `count` items of `width` bytes fit in the file from `offset` on; divides
+// instead of multiplying so that a crafted count cannot wrap around
+static bool in_file(const MappedFile &file, uint64_t offset, uint64_t count, uint64_t width)
+{
+    return offset <= file.size() && count <= (file.size() - offset) / width;
+}
+
+HistoryIndex::HistoryIndex(const MappedFile &file) : file_(file)
+{
+    if (file.size() < sizeof(HistoryHeader))
+    {
+        throw runtime_error("LOG ERROR: Truncated history header");
+    }
+    memcpy(&header_, file.begin(), sizeof(HistoryHeader));
+    if (memcmp(header_.magic, HISTORY_V2_MAGIC, sizeof(header_.magic)) != 0)
+    {
+        throw runtime_error("LOG ERROR: Not a v2 history file");
+    }
+    if (header_.version != HISTORY_V2_VERSION)
+    {
+        throw runtime_error("LOG ERROR: Unsupported history version " + to_string(header_.version));
+    }
+    if (header_.endian != HISTORY_V2_ENDIAN)
+    {
+        throw runtime_error("LOG ERROR: History written with a different byte order");
+    }
+    if (!in_file(file, header_.keys_offset, header_.n_keys, sizeof(uint64_t)) ||
+        !in_file(file, header_.sessions_offset, header_.n_sessions, sizeof(SessionEntry)) ||
+        (has_time_index() && !in_file(file, header_.time_index_offset, header_.n_trxs, sizeof(TimeIndexEntry))))
+    {
+        throw runtime_error("LOG ERROR: Truncated history index");
+    }
+
+    sessions_.resize(header_.n_sessions);
+    memcpy(sessions_.data(), file.begin() + header_.sessions_offset, sessions_.size() * sizeof(SessionEntry));
+    uint64_t n_trxs = 0;
+    for (const SessionEntry &entry : sessions_)
+    {
+        if (!in_file(file, entry.offset, entry.size, 1))
+        {
+            throw runtime_error("LOG ERROR: Session outside of the history file");
+        }
+        n_trxs += entry.n_trxs;
+    }
+    if (n_trxs != header_.n_trxs)
+    {
+        throw runtime_error("LOG ERROR: Session table does not match the history header");
+    }
+}
+
+const HistoryHeader &HistoryIndex::header() const { return header_; }
+size_t HistoryIndex::sessions() const { return sessions_.size(); }
+const SessionEntry &HistoryIndex::session(size_t i) const { return sessions_[i]; }
+
+MappedReader HistoryIndex::session_reader(size_t i) const
+{
+    const char *begin = file_.begin() + sessions_[i].offset;
+    return MappedReader(begin, begin + sessions_[i].size);
+}
+
+uint64_t HistoryIndex::key(uint32_t id) const
+{
+    if (id >= header_.n_keys)
+    {
+        throw runtime_error("LOG ERROR: Unknown key id");
+    }
+    uint64_t key;
+    memcpy(&key, file_.begin() + header_.keys_offset + id * sizeof(uint64_t), sizeof(uint64_t));
+    return key;
+}
+
+vector<uint64_t> HistoryIndex::keys() const
+{
+    vector<uint64_t> keys(header_.n_keys);
+    memcpy(keys.data(), file_.begin() + header_.keys_offset, keys.size() * sizeof(uint64_t));
+    return keys;
+}
+
+bool HistoryIndex::has_time_index() const { return (header_.flags & HISTORY_V2_TIME_INDEX) != 0; }
+
+TimeIndexEntry HistoryIndex::time(size_t i) const
+{
+    TimeIndexEntry entry;
+    memcpy(&entry, file_.begin() + header_.time_index_offset + i * sizeof(TimeIndexEntry), sizeof(TimeIndexEntry));
+    return entry;
+}
@@ -0,0 +1,85 @@
+#ifndef HISTORY_V2_H
+#define HISTORY_V2_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "transaction/log_reader.h"
+
+#define HISTORY_V2_MAGIC "VBOXHIST"
+#define HISTORY_V2_VERSION 2
+#define HISTORY_V2_ENDIAN 0x01020304u
+#define HISTORY_V2_TIME_INDEX 0x1u
+// smallest 'T' and operation records; counts read from a session are capped by
+// the bytes left divided by these before anything is reserved for them
+#define HISTORY_V2_TRX_BYTES 25
+#define HISTORY_V2_OP_BYTES 21
+
+// Indexed history container (loader "v2"), produced by LogConverter.
+// Integers are stored in the producer's byte order, recorded in the header.
+//
+//   HistoryHeader
+//   key dictionary   n_keys x u64, ascending; records refer to keys by index
+//   session payloads committed transactions only, see below
+//   session table    n_sessions x SessionEntry
+//   time index       n_trxs x TimeIndexEntry, optional: global start-time order
+//
+// Session payload records:
+//   'T' tid u32, start u64, end u64, n_ops u32
+//   'S' / 'C' oid u32, start u64, end u64
+//   'W' oid u32, start u64, end u64, key u32, field u64, value u32
+//   'R' oid u32, start u64, end u64, key u32, from_tid u32, from_oid u32
+//   'P' oid u32, start u64, end u64, field u64, left u32, right u32,
+//       n u32, n x key u32, n u32, n x from_tid u32, n u32, n x from_oid u32
+struct HistoryHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t flags;
+    uint32_t n_sessions;
+    uint64_t n_trxs;
+    uint64_t n_ops;
+    uint64_t n_keys;
+    uint64_t keys_offset;
+    uint64_t sessions_offset;
+    uint64_t time_index_offset;
+};
+
+struct SessionEntry
+{
+    uint64_t offset;
+    uint64_t size;
+    uint64_t n_trxs;
+    uint64_t n_ops;
+};
+
+struct TimeIndexEntry
+{
+    uint64_t start;
+    uint32_t session;
+    uint32_t reserved;
+};
+
+// Validated view of the tables of a mapped v2 container.
+class HistoryIndex
+{
+public:
+    HistoryIndex(const MappedFile &file);
+
+    const HistoryHeader &header() const;
+    size_t sessions() const;
+    const SessionEntry &session(size_t i) const;
+    MappedReader session_reader(size_t i) const;
+    uint64_t key(uint32_t id) const;
+    std::vector<uint64_t> keys() const; // the whole dictionary, indexed by key id
+    bool has_time_index() const;
+    TimeIndexEntry time(size_t i) const;
+
+private:
+    const MappedFile &file_;
+    HistoryHeader header_;
+    std::vector<SessionEntry> sessions_;
+};
+
+#endif // HISTORY_V2_H
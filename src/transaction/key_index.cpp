@@ -0,0 +1,149 @@
+#include "key_index.h"
+#include "transaction.h"
+#include <algorithm>
+#include <numeric>
+#include <utility>
+using namespace std;
+
+void KeyIndex::build_installs(const vector<HistoryPtr<Transaction>> &trxs, const OperatorStore &ops)
+{
+    size_t n_keys = ops.key_count();
+
+    // count, then place: vertices are visited in order, so every key run comes out ascending
+    vector<uint32_t> last_installer(n_keys, UINT32_MAX);
+    vector<pair<uint32_t, uint32_t>> installs; // (key, vertex)
+    vector<pair<uint32_t, uint32_t>> vertex_installs; // (key, oid) of the current vertex
+    install_offsets_.assign(n_keys + 1, 0);
+    vertex_offsets_.assign(1, 0);
+    vertex_keys_.clear();
+    vertex_oids_.clear();
+    for (size_t i = 0; i < trxs.size(); ++i)
+    {
+        const Transaction *trx = trxs[i].get();
+        vertex_installs.clear();
+        for (uint32_t k = trx->ops_begin(); k < trx->ops_end(); ++k)
+        {
+            if (ops.type(k) != OperatorType::WRITE)
+            {
+                continue;
+            }
+            uint32_t key = ops.key_id(k);
+            vertex_installs.emplace_back(key, ops.oid(k));
+            if (last_installer[key] != i)
+            {
+                last_installer[key] = i;
+                installs.emplace_back(key, i);
+                install_offsets_[key + 1]++;
+            }
+        }
+        // repeated writes of a key combine into one install carrying the largest oid
+        sort(vertex_installs.begin(), vertex_installs.end());
+        for (size_t m = 0; m < vertex_installs.size(); ++m)
+        {
+            if (m + 1 == vertex_installs.size() || vertex_installs[m + 1].first != vertex_installs[m].first)
+            {
+                vertex_keys_.push_back(vertex_installs[m].first);
+                vertex_oids_.push_back(vertex_installs[m].second);
+            }
+        }
+        vertex_offsets_.push_back(vertex_keys_.size());
+    }
+    partial_sum(install_offsets_.begin(), install_offsets_.end(), install_offsets_.begin());
+
+    installers_.resize(installs.size());
+    vector<uint32_t> cursor(install_offsets_.begin(), install_offsets_.end() - 1);
+    for (const auto &install : installs)
+    {
+        installers_[cursor[install.first]++] = install.second;
+    }
+}
+
+void KeyIndex::build_reads(const vector<HistoryPtr<Transaction>> &trxs, const OperatorStore &ops)
+{
+    size_t n_keys = ops.key_count();
+    vector<pair<uint32_t, pair<uint32_t, uint32_t>>> reads; // (key, (writer, reader))
+    read_offsets_.assign(n_keys + 1, 0);
+    for (size_t i = 0; i < trxs.size(); ++i)
+    {
+        const Transaction *trx = trxs[i].get();
+        for (uint32_t k = trx->ops_begin(); k < trx->ops_end(); ++k)
+        {
+            if (ops.type(k) == OperatorType::READ && ops.from_vertex(k) != UINT32_MAX)
+            {
+                reads.emplace_back(ops.key_id(k), make_pair(ops.from_vertex(k), static_cast<uint32_t>(i)));
+                read_offsets_[ops.key_id(k) + 1]++;
+            }
+        }
+    }
+    partial_sum(read_offsets_.begin(), read_offsets_.end(), read_offsets_.begin());
+
+    vector<pair<uint32_t, uint32_t>> pairs(reads.size());
+    vector<uint32_t> cursor(read_offsets_.begin(), read_offsets_.end() - 1);
+    for (const auto &read : reads)
+    {
+        pairs[cursor[read.first]++] = read.second;
+    }
+    // order each key run by writer, drop repeated reads of the same version
+    read_writers_.clear();
+    read_readers_.clear();
+    read_writers_.reserve(pairs.size());
+    read_readers_.reserve(pairs.size());
+    uint32_t begin = 0;
+    for (size_t key = 0; key < n_keys; ++key)
+    {
+        uint32_t end = read_offsets_[key + 1];
+        sort(pairs.begin() + begin, pairs.begin() + end);
+        read_offsets_[key] = read_writers_.size();
+        for (uint32_t m = begin; m < end; ++m)
+        {
+            if (m == begin || pairs[m] != pairs[m - 1])
+            {
+                read_writers_.push_back(pairs[m].first);
+                read_readers_.push_back(pairs[m].second);
+            }
+        }
+        begin = end;
+    }
+    read_offsets_[n_keys] = read_writers_.size();
+}
+
+void KeyIndex::clear()
+{
+    vertex_offsets_.clear();
+    vertex_keys_.clear();
+    vertex_oids_.clear();
+    install_offsets_.clear();
+    installers_.clear();
+    read_offsets_.clear();
+    read_writers_.clear();
+    read_readers_.clear();
+}
+
+size_t KeyIndex::size() const { return install_offsets_.empty() ? 0 : install_offsets_.size() - 1; }
+
+VertexRange KeyIndex::installers(uint32_t key) const
+{
+    return VertexRange(installers_.data() + install_offsets_[key], installers_.data() + install_offsets_[key + 1]);
+}
+
+VertexRange KeyIndex::readers(uint32_t key, uint32_t writer) const
+{
+    auto first = read_writers_.begin() + read_offsets_[key];
+    auto last = read_writers_.begin() + read_offsets_[key + 1];
+    auto range = equal_range(first, last, writer);
+    return VertexRange(read_readers_.data() + (range.first - read_writers_.begin()),
+                       read_readers_.data() + (range.second - read_writers_.begin()));
+}
+
+bool KeyIndex::install_oid(uint32_t vertex, uint32_t key, uint32_t &oid) const
+{
+    auto first = vertex_keys_.begin() + vertex_offsets_[vertex];
+    auto last = vertex_keys_.begin() + vertex_offsets_[vertex + 1];
+    auto it = lower_bound(first, last, key);
+    if (it == last || *it != key)
+    {
+        return false;
+    }
+    oid = vertex_oids_[it - vertex_keys_.begin()];
+    return true;
+}
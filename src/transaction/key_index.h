@@ -0,0 +1,58 @@
+#ifndef KEY_INDEX_H
+#define KEY_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "transaction/arena.h"
+
+class Transaction;
+class OperatorStore;
+
+// Contiguous run of vertex indices inside a KeyIndex table.
+class VertexRange
+{
+public:
+    VertexRange(const uint32_t *begin, const uint32_t *end) : begin_(begin), end_(end) {}
+
+    const uint32_t *begin() const { return begin_; }
+    const uint32_t *end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+
+private:
+    const uint32_t *begin_;
+    const uint32_t *end_;
+};
+
+// Per-key installers and read-from pairs of a loaded history, in CSR form.
+// Vertices are positions in TransactionManager::transactions(), keys are the
+// dense ids of OperatorStore::key_id().
+class KeyIndex
+{
+public:
+    // installers first; the read tables need OperatorStore::from_vertex()
+    void build_installs(const std::vector<HistoryPtr<Transaction>> &trxs, const OperatorStore &ops);
+    void build_reads(const std::vector<HistoryPtr<Transaction>> &trxs, const OperatorStore &ops);
+    void clear();
+
+    size_t size() const;
+    // oid of the version of `key` installed by `vertex`, false if it does not write the key
+    bool install_oid(uint32_t vertex, uint32_t key, uint32_t &oid) const;
+    // vertices writing the key, ascending
+    VertexRange installers(uint32_t key) const;
+    // vertices reading the key from `writer`, ascending
+    VertexRange readers(uint32_t key, uint32_t writer) const;
+
+private:
+    std::vector<uint32_t> vertex_offsets_; // vertex -> its installs, sorted by key
+    std::vector<uint32_t> vertex_keys_;
+    std::vector<uint32_t> vertex_oids_;
+    std::vector<uint32_t> install_offsets_;
+    std::vector<uint32_t> installers_;
+    std::vector<uint32_t> read_offsets_;
+    std::vector<uint32_t> read_writers_; // sorted by (writer, reader) within a key
+    std::vector<uint32_t> read_readers_;
+};
+
+#endif // KEY_INDEX_H
@@ -0,0 +1,249 @@
+#include "log_reader.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <chrono>
+using namespace std;
+
+MappedFile::MappedFile(const string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat file_info;
+    if (fstat(fd, &file_info) != 0)
+    {
+        close(fd);
+        return;
+    }
+    size_ = file_info.st_size;
+    if (size_ > 0)
+    {
+        void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            close(fd);
+            return;
+        }
+        madvise(addr, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(addr);
+    }
+    close(fd);
+    valid_ = true;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+bool MappedFile::valid() const { return valid_; }
+const char *MappedFile::begin() const { return data_; }
+const char *MappedFile::end() const { return data_ + size_; }
+size_t MappedFile::size() const { return size_; }
+
+///////////////////////////////////////////////////////////////////////
+
+bool compress_log(const string &path, const string &target, uint32_t block_size, int level)
+{
+    ifstream in(path, ios::binary);
+    ofstream out(target, ios::binary | ios::trunc);
+    if (!in || !out || block_size == 0)
+    {
+        return false;
+    }
+    uint32_t version = ZLOG_VERSION;
+    out.write(ZLOG_MAGIC, 8);
+    out.write(reinterpret_cast<const char *>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char *>(&block_size), sizeof(block_size));
+
+    vector<char> raw(block_size);
+    vector<char> packed(compressBound(block_size));
+    while (in)
+    {
+        in.read(raw.data(), block_size);
+        uint32_t raw_size = in.gcount();
+        if (raw_size == 0)
+        {
+            break;
+        }
+        uLongf packed_size = packed.size();
+        if (compress2(reinterpret_cast<Bytef *>(packed.data()), &packed_size,
+                      reinterpret_cast<const Bytef *>(raw.data()), raw_size, level) != Z_OK)
+        {
+            return false;
+        }
+        uint32_t size = packed_size;
+        out.write(reinterpret_cast<const char *>(&raw_size), sizeof(raw_size));
+        out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        out.write(packed.data(), size);
+    }
+    return static_cast<bool>(out);
+}
+
+///////////////////////////////////////////////////////////////////////
+
+BlockReader::BlockReader(const string &path, size_t depth) : in_(path, ios::binary), depth_(depth)
+{
+    if (!in_)
+    {
+        return;
+    }
+    char magic[8];
+    uint32_t version, block_size;
+    in_.read(magic, sizeof(magic));
+    in_.read(reinterpret_cast<char *>(&version), sizeof(version));
+    in_.read(reinterpret_cast<char *>(&block_size), sizeof(block_size));
+    if (!in_ || memcmp(magic, ZLOG_MAGIC, sizeof(magic)) != 0)
+    {
+        throw runtime_error("LOG ERROR: Not a compressed log: " + path);
+    }
+    if (version != ZLOG_VERSION)
+    {
+        throw runtime_error("LOG ERROR: Unsupported compressed log version " + to_string(version));
+    }
+    if (block_size == 0)
+    {
+        throw runtime_error("LOG ERROR: Invalid compressed log block size: " + path);
+    }
+    block_size_ = block_size;
+    valid_ = true;
+    decoder_ = thread(&BlockReader::decode, this);
+}
+
+BlockReader::~BlockReader()
+{
+    if (decoder_.joinable())
+    {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        decoder_.join();
+    }
+}
+
+bool BlockReader::valid() const { return valid_; }
+const DecodeStats &BlockReader::stats() const { return stats_; }
+
+void BlockReader::decode()
+{
+    try
+    {
+        vector<char> packed;
+        uint32_t raw_size, packed_size;
+        while (in_.read(reinterpret_cast<char *>(&raw_size), sizeof(raw_size)))
+        {
+            if (!in_.read(reinterpret_cast<char *>(&packed_size), sizeof(packed_size)))
+            {
+                throw runtime_error("LOG ERROR: Truncated compressed block");
+            }
+            // no block inflates past the header's block size, nor deflates past its bound
+            if (raw_size > block_size_ || packed_size > compressBound(block_size_))
+            {
+                throw runtime_error("LOG ERROR: Corrupt compressed block");
+            }
+            packed.resize(packed_size);
+            if (!in_.read(packed.data(), packed_size))
+            {
+                throw runtime_error("LOG ERROR: Truncated compressed block");
+            }
+
+            vector<char> block;
+            {
+                lock_guard<mutex> lock(mutex_);
+                if (!spare_.empty())
+                {
+                    block = move(spare_.back());
+                    spare_.pop_back();
+                }
+            }
+            block.resize(raw_size);
+            auto decode_start = chrono::high_resolution_clock::now();
+            uLongf size = raw_size;
+            if (uncompress(reinterpret_cast<Bytef *>(block.data()), &size,
+                           reinterpret_cast<const Bytef *>(packed.data()), packed_size) != Z_OK ||
+                size != raw_size)
+            {
+                throw runtime_error("LOG ERROR: Corrupt compressed block");
+            }
+            auto decode_end = chrono::high_resolution_clock::now();
+            stats_.decode_time += chrono::duration_cast<chrono::microseconds>(decode_end - decode_start).count();
+            stats_.packed_bytes += sizeof(raw_size) + sizeof(packed_size) + packed_size;
+            stats_.raw_bytes += raw_size;
+
+            unique_lock<mutex> lock(mutex_);
+            cv_.wait(lock, [&]()
+                     { return ready_.size() < depth_ || stop_; });
+            if (stop_)
+            {
+                return;
+            }
+            ready_.push_back(move(block));
+            cv_.notify_all();
+        }
+    }
+    catch (...)
+    {
+        lock_guard<mutex> lock(mutex_);
+        error_ = current_exception();
+    }
+    lock_guard<mutex> lock(mutex_);
+    done_ = true;
+    cv_.notify_all();
+}
+
+bool BlockReader::fill()
+{
+    unique_lock<mutex> lock(mutex_);
+    do
+    {
+        if (block_.capacity() > 0)
+        {
+            spare_.push_back(move(block_));
+            block_ = vector<char>();
+        }
+        cv_.wait(lock, [&]()
+                 { return !ready_.empty() || done_; });
+        if (ready_.empty())
+        {
+            cur_ = end_ = nullptr;
+            if (error_)
+            {
+                rethrow_exception(error_);
+            }
+            return false;
+        }
+        block_ = move(ready_.front());
+        ready_.pop_front();
+        cv_.notify_all();
+    } while (block_.empty());
+    cur_ = block_.data();
+    end_ = cur_ + block_.size();
+    return true;
+}
+
+void BlockReader::read_split(char *out, size_t n)
+{
+    while (n > 0)
+    {
+        if (cur_ == end_ && !fill())
+        {
+            throw runtime_error("LOG ERROR: Truncated record");
+        }
+        size_t chunk = min(n, static_cast<size_t>(end_ - cur_));
+        memcpy(out, cur_, chunk);
+        out += chunk;
+        cur_ += chunk;
+        n -= chunk;
+    }
+}
@@ -0,0 +1,162 @@
+#ifndef LOG_READER_H
+#define LOG_READER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define ZLOG_MAGIC "VBOXZLOG"
+#define ZLOG_VERSION 1
+
+// Read-only memory mapping of a whole log file.
+class MappedFile
+{
+public:
+    MappedFile(const std::string &path);
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool valid() const;
+    const char *begin() const;
+    const char *end() const;
+    size_t size() const;
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool valid_ = false;
+};
+
+// Pulls fields out of an std::istream, one read call per field.
+class StreamReader
+{
+public:
+    StreamReader(std::istream &in) : in_(in) {}
+
+    bool next(char &op) { return static_cast<bool>(in_.read(&op, 1)); }
+
+    template <typename T>
+    void read(T &value) { in_.read(reinterpret_cast<char *>(&value), sizeof(T)); }
+
+private:
+    std::istream &in_;
+};
+
+// Decodes fields straight from a byte range (e.g. a MappedFile), with bounds checking.
+class MappedReader
+{
+public:
+    MappedReader(const char *begin, const char *end) : cur_(begin), end_(end) {}
+
+    bool next(char &op)
+    {
+        if (cur_ == end_)
+        {
+            return false;
+        }
+        op = *cur_++;
+        return true;
+    }
+
+    template <typename T>
+    void read(T &value)
+    {
+        if (static_cast<size_t>(end_ - cur_) < sizeof(T))
+        {
+            throw std::runtime_error("LOG ERROR: Truncated record");
+        }
+        std::memcpy(&value, cur_, sizeof(T));
+        cur_ += sizeof(T);
+    }
+
+    size_t remaining() const { return end_ - cur_; }
+
+private:
+    const char *cur_;
+    const char *end_;
+};
+
+// Compressed session log (loader "zlib"), written by LogConverter:
+//   ZLOG_MAGIC | version u32 | block size u32 | { raw size u32 | packed size u32 | zlib stream }*
+// Blocks are deflated independently and records may straddle block boundaries.
+bool compress_log(const std::string &path, const std::string &target, uint32_t block_size, int level);
+
+struct DecodeStats
+{
+    size_t packed_bytes = 0;
+    size_t raw_bytes = 0;
+    long decode_time = 0; // us spent inflating
+};
+
+// Streams the records of a compressed session log. A decoder thread inflates
+// the blocks ahead of the parser, keeping at most `depth` of them queued.
+class BlockReader
+{
+public:
+    BlockReader(const std::string &path, size_t depth = 4);
+    ~BlockReader();
+    BlockReader(const BlockReader &) = delete;
+    BlockReader &operator=(const BlockReader &) = delete;
+
+    bool valid() const;
+
+    bool next(char &op)
+    {
+        if (cur_ == end_ && !fill())
+        {
+            return false;
+        }
+        op = *cur_++;
+        return true;
+    }
+
+    template <typename T>
+    void read(T &value)
+    {
+        if (static_cast<size_t>(end_ - cur_) >= sizeof(T))
+        {
+            std::memcpy(&value, cur_, sizeof(T));
+            cur_ += sizeof(T);
+            return;
+        }
+        read_split(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    // only complete once the reader has run into the end of the log
+    const DecodeStats &stats() const;
+
+private:
+    bool fill();
+    void read_split(char *out, size_t n);
+    void decode();
+
+private:
+    std::ifstream in_;
+    bool valid_ = false;
+    uint32_t block_size_ = 0; // raw bytes of a full block, from the header
+    size_t depth_;
+    std::thread decoder_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::vector<char>> ready_;
+    std::vector<std::vector<char>> spare_;
+    std::vector<char> block_;
+    const char *cur_ = nullptr;
+    const char *end_ = nullptr;
+    bool done_ = false;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    DecodeStats stats_;
+};
+
+#endif // LOG_READER_H
@@ -0,0 +1,140 @@
+#ifndef SESSION_BUILDER_H
+#define SESSION_BUILDER_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "transaction/transaction.h"
+
+// A decoded record of the transaction currently being read. Rows are only
+// appended to the session's store once the transaction turns out not to abort.
+struct PendingOperator
+{
+    char type;
+    uint32_t oid;
+    uint64_t start;
+    uint64_t end;
+    uint64_t key;   // W, R
+    uint64_t field; // W, P
+    uint32_t x;     // W: value, R: from_tid, P: left bound
+    uint32_t y;     // R: from_oid, P: right bound
+    uint32_t size;  // P: number of results, stored from offset in the pending result arrays
+    size_t offset;
+};
+
+class SessionBuilder
+{
+public:
+    SessionBuilder(Session &session, HistoryAllocator &alloc) : session_(session), alloc_(alloc) {}
+
+    void begin(uint32_t tid, uint64_t start, uint64_t end)
+    {
+        flush();
+        open_ = true;
+        tid_ = tid;
+        start_ = start;
+        end_ = end;
+    }
+
+    PendingOperator &append(char type, uint32_t oid, uint64_t start, uint64_t end)
+    {
+        if (!open_)
+        {
+            throw std::runtime_error("LOG ERROR: Operation outside of a transaction");
+        }
+        ops_.push_back(PendingOperator{type, oid, start, end, 0, 0, 0, 0, 0, 0});
+        return ops_.back();
+    }
+
+    void commit(uint32_t oid, uint64_t start, uint64_t end)
+    {
+        append('C', oid, start, end);
+        if (ops_.size() > 1)
+        {
+            start_ = ops_[1].start;
+        }
+        flush();
+    }
+
+    bool open() const { return open_; }
+
+    void abort()
+    {
+        if (!open_)
+        {
+            throw std::runtime_error("LOG ERROR: Operation outside of a transaction");
+        }
+        clear();
+    }
+
+    // transaction still open at end of log (or at the next 'T') is kept as is
+    void flush()
+    {
+        if (!open_)
+        {
+            return;
+        }
+        HistoryPtr<Transaction> trx = alloc_.make<Transaction>(tid_, start_, end_);
+        OperatorStore &store = session_.ops;
+        uint32_t begin = store.size();
+        for (const PendingOperator &op : ops_)
+        {
+            switch (op.type)
+            {
+            case 'S':
+                store.append(OperatorType::BEGIN, op.oid, op.start, op.end);
+                break;
+            case 'C':
+                store.append(OperatorType::COMMIT, op.oid, op.start, op.end);
+                break;
+            case 'W':
+                store.append_write(op.oid, op.start, op.end, op.key, op.field, op.x);
+                break;
+            case 'R':
+                store.append_read(op.oid, op.start, op.end, op.key, op.x, op.y);
+                break;
+            case 'P':
+                store.append_predicate(op.oid, op.start, op.end,
+                                       Predicate(op.field, op.x, op.y,
+                                                 std::vector<uint64_t>(keys_.begin() + op.offset, keys_.begin() + op.offset + op.size),
+                                                 std::vector<uint32_t>(from_tids_.begin() + op.offset, from_tids_.begin() + op.offset + op.size),
+                                                 std::vector<uint32_t>(from_oids_.begin() + op.offset, from_oids_.begin() + op.offset + op.size)));
+                break;
+            default:
+                break;
+            }
+        }
+        trx->set_ops_range(&store, begin, store.size());
+        session_.trxs.emplace_back(std::move(trx));
+        clear();
+    }
+
+    std::vector<uint64_t> &keys() { return keys_; }
+    std::vector<uint32_t> &from_tids() { return from_tids_; }
+    std::vector<uint32_t> &from_oids() { return from_oids_; }
+
+private:
+    void clear()
+    {
+        open_ = false;
+        ops_.clear();
+        keys_.clear();
+        from_tids_.clear();
+        from_oids_.clear();
+    }
+
+private:
+    Session &session_;
+    HistoryAllocator &alloc_;
+    bool open_ = false;
+    uint32_t tid_ = 0;
+    uint64_t start_ = 0;
+    uint64_t end_ = 0;
+    std::vector<PendingOperator> ops_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> from_tids_;
+    std::vector<uint32_t> from_oids_;
+};
+
+#endif // SESSION_BUILDER_H
@@ -1,4 +1,7 @@
 #include "transaction.h"
+#include "log_reader.h"
+#include "session_builder.h"
+#include "foreign_log.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
@@ -8,197 +11,440 @@
 #include <sys/stat.h>
 #include <queue>
 #include <unordered_set>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 using namespace std;
 
-Operator::Operator(uint32_t oid, uint64_t start, uint64_t end)
-    : oid_(oid), start_(start), end_(end) {}
+Write::Write(uint32_t row, uint32_t oid, const FieldUpdate &update)
+    : row_(row), oid_(oid), update_(update) {}
 
-uint32_t Operator::oid() const { return oid_; }
-uint64_t Operator::start() const { return start_; }
-uint64_t Operator::end() const { return end_; }
+uint32_t Write::row() const { return row_; }
+uint32_t Write::oid() const { return oid_; }
 
-Read::Read(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint32_t from_tid, uint32_t from_oid)
-    : Operator(oid, start, end), key_(key), from_tid_(from_tid), from_oid_(from_oid) {}
-OperatorType Read::type() const { return OperatorType::READ; }
+UpdateRange Write::updates() const
+{
+    if (spilled_.empty())
+    {
+        return UpdateRange(&update_, &update_ + 1);
+    }
+    return UpdateRange(spilled_.data(), spilled_.data() + spilled_.size());
+}
 
-uint64_t Read::key() const { return key_; }
-uint32_t Read::from_tid() const { return from_tid_; }
-uint32_t Read::from_oid() const { return from_oid_; }
+static bool update_less(const FieldUpdate &update, uint64_t field) { return update.field < field; }
 
-string Read::to_string() const
+const FieldUpdate *Write::find(uint64_t field) const
 {
-    ostringstream oss;
-    oss << "Read(oid=" << oid_ << ", start=" << start_ << ", end=" << end_ << ", key=" << key_ << ", from_tid=" << from_tid_ << ", from_oid=" << from_oid_ << ")";
-    return oss.str();
+    UpdateRange range = updates();
+    const FieldUpdate *it = lower_bound(range.begin(), range.end(), field, update_less);
+    return it != range.end() && it->field == field ? it : nullptr;
 }
 
-Write::Write(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint64_t field, uint32_t value)
-    : Operator(oid, start, end), key_(key)
+void Write::insert(const FieldUpdate &update)
 {
-    updates_[field] = value;
-    fields_.insert(field);
-    values_.insert(value);
+    if (spilled_.empty())
+    {
+        spilled_.push_back(update_);
+    }
+    spilled_.insert(lower_bound(spilled_.begin(), spilled_.end(), update.field, update_less), update);
 }
-OperatorType Write::type() const { return OperatorType::WRITE; }
-
-uint64_t Write::key() const { return key_; }
-unordered_map<uint64_t, uint32_t> Write::updates() { return updates_; }
 
-void Write::combine(Write *other)
+void Write::combine(const Write &other)
 {
-    for (const auto &update : other->updates())
+    // the later write wins a field both of them update
+    bool later = oid_ <= other.oid();
+    for (const FieldUpdate &update : other.updates())
     {
-        uint64_t filed = update.first;
-        uint32_t value = update.second;
-        if (updates_.count(filed) > 0)
+        FieldUpdate *first = spilled_.empty() ? &update_ : spilled_.data();
+        FieldUpdate *last = spilled_.empty() ? &update_ + 1 : spilled_.data() + spilled_.size();
+        FieldUpdate *it = lower_bound(first, last, update.field, update_less);
+        if (it == last || it->field != update.field)
         {
-            updates_[filed] = oid_ > other->oid() ? updates_[filed] : value;
+            insert(update);
         }
-        else
+        else if (later)
         {
-            updates_[filed] = value;
+            it->value = update.value;
         }
     }
-    oid_ = max(oid_, other->oid());
+    oid_ = max(oid_, other.oid());
 }
 
-string Write::to_string() const
+void UnitedPredicate::add(const Predicate *p)
 {
-    ostringstream oss;
-    oss << "Write(oid=" << oid_ << ", start=" << start_ << ", end=" << end_ << ", key=" << key_ << ")";
-    return oss.str();
+    keys_.push_back(&p->keys_);
+    auto field = lower_bound(fields_.begin(), fields_.end(), p->field_);
+    if (field == fields_.end() || *field != p->field_)
+    {
+        fields_.insert(field, p->field_);
+    }
+    if (p->left_bound_ > p->right_bound_)
+    {
+        return; // matches nothing
+    }
+    // merge with every interval of the field it overlaps or touches
+    Bound bound{p->field_, p->left_bound_, p->right_bound_};
+    auto first = lower_bound(bounds_.begin(), bounds_.end(), bound.field, field_less);
+    while (first != bounds_.end() && first->field == bound.field && uint64_t(first->right) + 1 < bound.left)
+    {
+        ++first;
+    }
+    auto last = first;
+    while (last != bounds_.end() && last->field == bound.field && last->left <= uint64_t(bound.right) + 1)
+    {
+        bound.left = min(bound.left, last->left);
+        bound.right = max(bound.right, last->right);
+        ++last;
+    }
+    bounds_.insert(bounds_.erase(first, last), bound);
 }
 
-Begin::Begin(uint32_t oid, uint64_t start, uint64_t end) : Operator(oid, start, end) {}
-OperatorType Begin::type() const { return OperatorType::BEGIN; }
+bool UnitedPredicate::cover(uint64_t key) const
+{
+    for (const vector<uint64_t> *keys : keys_)
+    {
+        if (binary_search(keys->begin(), keys->end(), key))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-string Begin::to_string() const
+bool UnitedPredicate::relevant(const Write *write) const
 {
-    ostringstream oss;
-    oss << "Begin(oid=" << oid_ << ", start=" << start_ << ", end=" << end_ << ")";
-    return oss.str();
+    for (const FieldUpdate &update : write->updates())
+    {
+        if (binary_search(fields_.begin(), fields_.end(), update.field))
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
-Commit::Commit(uint32_t oid, uint64_t start, uint64_t end) : Operator(oid, start, end) {}
-OperatorType Commit::type() const { return OperatorType::COMMIT; }
+bool UnitedPredicate::match(const Write *write) const
+{
+    for (const FieldUpdate &update : write->updates())
+    {
+        if (contains(update.field, update.value, update.value))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-string Commit::to_string() const
+bool UnitedPredicate::contains(uint64_t field, uint32_t low, uint32_t high) const
 {
-    ostringstream oss;
-    oss << "Commit(oid=" << oid_ << ", start=" << start_ << ", end=" << end_ << ")";
-    return oss.str();
+    // the only candidate is the last interval of the field starting at or before low
+    auto it = upper_bound(bounds_.begin(), bounds_.end(), make_pair(field, low),
+                          [](const pair<uint64_t, uint32_t> &value, const Bound &bound)
+                          { return value.first < bound.field || (value.first == bound.field && value.second < bound.left); });
+    return it != bounds_.begin() && (it - 1)->field == field && high <= (it - 1)->right;
 }
 
-Abort::Abort(uint32_t oid, uint64_t start, uint64_t end) : Operator(oid, start, end) {}
-OperatorType Abort::type() const { return OperatorType::ABORT; }
+///////////////////////////////////////////////////////////////////////
 
-string Abort::to_string() const
+template <typename T>
+static void sort_unique(vector<T> &values)
 {
-    ostringstream oss;
-    oss << "Abort(oid=" << oid_ << ", start=" << start_ << ", end=" << end_ << ")";
-    return oss.str();
+    sort(values.begin(), values.end());
+    values.erase(unique(values.begin(), values.end()), values.end());
+    values.shrink_to_fit();
 }
 
-void UnitedPredicate::add(Predicate *p)
+Predicate::Predicate(uint64_t field, uint32_t left_bound, uint32_t right_bound,
+                     vector<uint64_t> keys, vector<uint32_t> from_tids, vector<uint32_t> from_oids)
+    : field_(field), keys_(move(keys)), from_tids_(move(from_tids)), from_oids_(move(from_oids)), left_bound_(left_bound), right_bound_(right_bound)
 {
-    fields_.insert(p->field_);
-    keys_.insert(p->keys_.begin(), p->keys_.end());
-    bounds_[p->field_].emplace_back(p->left_bound_, p->right_bound_);
+    sort_unique(keys_);
+    sort_unique(from_tids_);
+    sort_unique(from_oids_);
 }
 
-bool UnitedPredicate::cover(uint64_t key)
+const vector<uint64_t> &Predicate::keys() const { return keys_; }
+const vector<uint32_t> &Predicate::from_tids() const { return from_tids_; }
+const vector<uint32_t> &Predicate::from_oids() const { return from_oids_; }
+uint64_t Predicate::field() const { return field_; }
+uint32_t Predicate::left_bound() const { return left_bound_; }
+uint32_t Predicate::right_bound() const { return right_bound_; }
+
+bool Predicate::relevant(const Write *write) const
+{
+    return write->find(field_) != nullptr;
+}
+
+bool Predicate::match(const Write *write) const
+{
+    const FieldUpdate *update = write->find(field_);
+    return update != nullptr && update->value >= left_bound_ && update->value <= right_bound_;
+}
+
+bool Predicate::cover(uint64_t key) const
 {
-    return keys_.count(key) > 0;
+    return binary_search(keys_.begin(), keys_.end(), key);
 }
 
-bool UnitedPredicate::relevant(Write *write)
+Transaction::Transaction(uint32_t tid, uint64_t start, uint64_t end)
+    : tid_(tid), start_(start), end_(end) {}
+
+uint32_t Transaction::tid() const { return tid_; }
+uint64_t Transaction::start() const { return start_; }
+uint64_t Transaction::end() const { return end_; }
+
+void Transaction::set_start(uint64_t start) { start_ = start; }
+void Transaction::set_end(uint64_t end) { end_ = end; }
+
+const OperatorStore *Transaction::operators() const { return ops_; }
+uint32_t Transaction::ops_begin() const { return ops_begin_; }
+uint32_t Transaction::ops_end() const { return ops_end_; }
+void Transaction::set_ops_range(const OperatorStore *ops, uint32_t begin, uint32_t end)
 {
+    ops_ = ops;
+    ops_begin_ = begin;
+    ops_end_ = end;
+}
 
-    for (const auto &f : fields_)
+string Transaction::to_string() const
+{
+    ostringstream oss;
+    oss << "Transaction(tid=" << tid_ << ", start=" << start_ << ", end=" << end_ << ", operators=[\n";
+    for (uint32_t k = ops_begin_; k < ops_end_; ++k)
     {
-        if (write->updates().count(f) > 0)
-        {
-            return true;
-        }
+        oss << "  " << ops_->to_string(k) << "\n";
     }
-    return false;
+    oss << "])";
+    return oss.str();
 }
-bool UnitedPredicate::match(Write *write)
+
+///////////////////////////////////////////////////////////////////////
+
+void TidTable::build(const vector<HistoryPtr<Transaction>> &trxs)
 {
-    for (const auto &update : write->updates())
+    direct_.clear();
+    sorted_.clear();
+    uint32_t max_tid = 0;
+    for (const HistoryPtr<Transaction> &trx : trxs)
+    {
+        max_tid = max(max_tid, trx->tid());
+    }
+    // a later transaction with the same id wins, as it did in the verifiers' maps
+    if (max_tid < 8 * trxs.size() + 64)
     {
-        uint64_t f = update.first;
-        uint64_t v = update.second;
-        if (bounds_.count(f) > 0)
+        direct_.assign(static_cast<size_t>(max_tid) + 1, UINT32_MAX);
+        for (size_t i = 0; i < trxs.size(); ++i)
         {
-            for (const auto &bound : bounds_[f])
-            {
-                if (v >= bound.first && v <= bound.second)
-                {
-                    return true;
-                }
-            }
+            direct_[trxs[i]->tid()] = i;
         }
+        return;
     }
-    return false;
+    sorted_.reserve(trxs.size());
+    for (size_t i = 0; i < trxs.size(); ++i)
+    {
+        sorted_.emplace_back(trxs[i]->tid(), i);
+    }
+    sort(sorted_.begin(), sorted_.end());
+    auto last = unique(sorted_.rbegin(), sorted_.rend(),
+                       [](const pair<uint32_t, uint32_t> &a, const pair<uint32_t, uint32_t> &b)
+                       { return a.first == b.first; });
+    sorted_.erase(sorted_.begin(), last.base());
+}
+
+uint32_t TidTable::find(uint32_t tid) const
+{
+    if (!sorted_.empty())
+    {
+        auto it = lower_bound(sorted_.begin(), sorted_.end(), make_pair(tid, 0u));
+        return (it != sorted_.end() && it->first == tid) ? it->second : UINT32_MAX;
+    }
+    return tid < direct_.size() ? direct_[tid] : UINT32_MAX;
 }
 
 ///////////////////////////////////////////////////////////////////////
 
-Predicate::Predicate(uint32_t oid, uint64_t start, uint64_t end, uint64_t field, uint32_t left_bound,
-                     uint32_t right_bound, unordered_set<uint64_t> keys, unordered_set<uint32_t> from_tids, unordered_set<uint32_t> from_oids)
-    : Operator(oid, start, end), field_(field), keys_(keys), from_tids_(from_tids), from_oids_(from_oids), left_bound_(left_bound), right_bound_(right_bound) {}
+void OperatorStore::reserve(size_t n)
+{
+    types_.reserve(n);
+    oids_.reserve(n);
+    starts_.reserve(n);
+    ends_.reserve(n);
+    keys_.reserve(n);
+    key_ids_.reserve(n);
+    from_tids_.reserve(n);
+    from_oids_.reserve(n);
+    from_vertices_.reserve(n);
+    payloads_.reserve(n);
+}
+
+void OperatorStore::clear()
+{
+    types_.clear();
+    oids_.clear();
+    starts_.clear();
+    ends_.clear();
+    keys_.clear();
+    key_ids_.clear();
+    from_tids_.clear();
+    from_oids_.clear();
+    from_vertices_.clear();
+    payloads_.clear();
+    updates_.clear();
+    predicates_.clear();
+    key_dict_.clear();
+}
 
-OperatorType Predicate::type() const { return OperatorType::PREDICATE; }
+size_t OperatorStore::size() const { return types_.size(); }
 
-const unordered_set<uint64_t> &Predicate::keys() const { return keys_; }
-const unordered_set<uint32_t> &Predicate::from_tids() const { return from_tids_; }
-const unordered_set<uint32_t> &Predicate::from_oids() const { return from_oids_; }
+size_t OperatorStore::bytes() const
+{
+    return types_.capacity() * sizeof(OperatorType) + oids_.capacity() * sizeof(uint32_t) +
+           starts_.capacity() * sizeof(uint64_t) + ends_.capacity() * sizeof(uint64_t) +
+           keys_.capacity() * sizeof(uint64_t) + key_ids_.capacity() * sizeof(uint32_t) + from_tids_.capacity() * sizeof(uint32_t) +
+           from_oids_.capacity() * sizeof(uint32_t) + from_vertices_.capacity() * sizeof(uint32_t) + payloads_.capacity() * sizeof(uint32_t) +
+           updates_.capacity() * sizeof(FieldUpdate) + predicates_.capacity() * sizeof(Predicate) +
+           key_dict_.capacity() * sizeof(uint64_t);
+}
 
-bool Predicate::relevant(Write *write) const
+void OperatorStore::push_row(OperatorType type, uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint32_t key_id, uint32_t from_tid, uint32_t from_oid, uint32_t payload)
 {
-    return write->updates().count(field_) > 0;
+    types_.push_back(type);
+    oids_.push_back(oid);
+    starts_.push_back(start);
+    ends_.push_back(end);
+    keys_.push_back(key);
+    key_ids_.push_back(key_id);
+    from_tids_.push_back(from_tid);
+    from_oids_.push_back(from_oid);
+    from_vertices_.push_back(UINT32_MAX);
+    payloads_.push_back(payload);
 }
 
-bool Predicate::match(Write *write) const
+void OperatorStore::append(OperatorType type, uint32_t oid, uint64_t start, uint64_t end)
 {
-    return relevant(write) && write->updates()[field_] >= left_bound_ && write->updates()[field_] <= right_bound_;
+    push_row(type, oid, start, end, 0, NO_KEY_ID, 0, 0, 0);
 }
 
-bool Predicate::cover(uint64_t key) const
+void OperatorStore::append_read(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint32_t from_tid, uint32_t from_oid, uint32_t key_id)
 {
-    return keys_.count(key) > 0;
+    push_row(OperatorType::READ, oid, start, end, key, key_id, from_tid, from_oid, 0);
 }
 
-string Predicate::to_string() const
+void OperatorStore::append_write(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint64_t field, uint32_t value, uint32_t key_id)
 {
-    ostringstream oss;
-    oss << "Predicate(oid=" << oid_ << ", start=" << start_ << ", end=" << end_ << ", field=" << field_ << ", left=" << left_bound_ << ", right=" << right_bound_ << ")";
-    return oss.str();
+    push_row(OperatorType::WRITE, oid, start, end, key, key_id, 0, 0, updates_.size());
+    updates_.push_back(FieldUpdate{field, value});
 }
 
-Transaction::Transaction(uint32_t tid, uint64_t start, uint64_t end)
-    : tid_(tid), start_(start), end_(end) {}
+void OperatorStore::append_predicate(uint32_t oid, uint64_t start, uint64_t end, Predicate predicate)
+{
+    push_row(OperatorType::PREDICATE, oid, start, end, 0, NO_KEY_ID, 0, 0, predicates_.size());
+    predicates_.emplace_back(move(predicate));
+}
 
-void Transaction::append_operator(unique_ptr<Operator> operateor) { operators_.emplace_back(move(operateor)); }
-const vector<unique_ptr<Operator>> &Transaction::operators() const { return operators_; }
+void OperatorStore::append(const OperatorStore &other, uint32_t begin, uint32_t end)
+{
+    for (uint32_t k = begin; k < end; ++k)
+    {
+        switch (other.types_[k])
+        {
+        case OperatorType::READ:
+            append_read(other.oids_[k], other.starts_[k], other.ends_[k], other.keys_[k], other.from_tids_[k], other.from_oids_[k], other.key_ids_[k]);
+            break;
+        case OperatorType::WRITE:
+            append_write(other.oids_[k], other.starts_[k], other.ends_[k], other.keys_[k], other.update(k).field, other.update(k).value, other.key_ids_[k]);
+            break;
+        case OperatorType::PREDICATE:
+            append_predicate(other.oids_[k], other.starts_[k], other.ends_[k], other.predicate(k));
+            break;
+        default:
+            append(other.types_[k], other.oids_[k], other.starts_[k], other.ends_[k]);
+            break;
+        }
+    }
+}
 
-uint32_t Transaction::tid() const { return tid_; }
-uint64_t Transaction::start() const { return start_; }
-uint64_t Transaction::end() const { return end_; }
+void OperatorStore::intern_keys()
+{
+    if (!key_dict_.empty())
+    {
+        return;
+    }
+    unordered_map<uint64_t, uint32_t> ids;
+    for (size_t k = 0; k < size(); ++k)
+    {
+        if (types_[k] != OperatorType::READ && types_[k] != OperatorType::WRITE)
+        {
+            continue;
+        }
+        auto it = ids.emplace(keys_[k], key_dict_.size()).first;
+        if (it->second == key_dict_.size())
+        {
+            key_dict_.push_back(keys_[k]);
+        }
+        key_ids_[k] = it->second;
+    }
+}
 
-void Transaction::set_start(uint64_t start) { start_ = start; }
-void Transaction::set_end(uint64_t end) { end_ = end; }
+void OperatorStore::set_key_dict(vector<uint64_t> dict) { key_dict_ = move(dict); }
 
-string Transaction::to_string() const
+size_t OperatorStore::key_count() const { return key_dict_.size(); }
+
+uint32_t OperatorStore::resolve_reads(const TidTable &tids, const KeyIndex &index)
+{
+    uint32_t invalid = UINT32_MAX;
+    for (size_t k = 0; k < size(); ++k)
+    {
+        if (types_[k] != OperatorType::READ)
+        {
+            continue;
+        }
+        uint32_t from = tids.find(from_tids_[k]);
+        from_vertices_[k] = from;
+        if (invalid != UINT32_MAX || from_tids_[k] == 0)
+        {
+            continue;
+        }
+        uint32_t oid;
+        if (from == UINT32_MAX || !index.install_oid(from, key_ids_[k], oid) || oid != from_oids_[k])
+        {
+            invalid = k;
+        }
+    }
+    return invalid;
+}
+
+string OperatorStore::to_string(uint32_t k) const
 {
     ostringstream oss;
-    oss << "Transaction(tid=" << tid_ << ", start=" << start_ << ", end=" << end_ << ", operators=[\n";
-    for (const auto &op : operators_)
+    switch (types_[k])
+    {
+    case OperatorType::READ:
+        oss << "Read(oid=" << oids_[k] << ", start=" << starts_[k] << ", end=" << ends_[k] << ", key=" << keys_[k] << ", from_tid=" << from_tids_[k] << ", from_oid=" << from_oids_[k] << ")";
+        break;
+    case OperatorType::WRITE:
+        oss << "Write(oid=" << oids_[k] << ", start=" << starts_[k] << ", end=" << ends_[k] << ", key=" << keys_[k] << ")";
+        break;
+    case OperatorType::BEGIN:
+        oss << "Begin(oid=" << oids_[k] << ", start=" << starts_[k] << ", end=" << ends_[k] << ")";
+        break;
+    case OperatorType::COMMIT:
+        oss << "Commit(oid=" << oids_[k] << ", start=" << starts_[k] << ", end=" << ends_[k] << ")";
+        break;
+    case OperatorType::ABORT:
+        oss << "Abort(oid=" << oids_[k] << ", start=" << starts_[k] << ", end=" << ends_[k] << ")";
+        break;
+    case OperatorType::PREDICATE:
     {
-        oss << "  " << op->to_string() << "\n";
+        const Predicate &p = predicate(k);
+        oss << "Predicate(oid=" << oids_[k] << ", start=" << starts_[k] << ", end=" << ends_[k] << ", field=" << p.field() << ", left=" << p.left_bound() << ", right=" << p.right_bound() << ")";
+    }
+    break;
     }
-    oss << "])";
     return oss.str();
 }
 
@@ -206,14 +452,120 @@ string Transaction::to_string() const
 
 TransactionManager::TransactionManager() {}
 
-const vector<unique_ptr<Transaction>> &TransactionManager::transactions() const { return trxs_; }
+const vector<HistoryPtr<Transaction>> &TransactionManager::transactions() const { return trxs_; }
+const OperatorStore &TransactionManager::operator_store() const { return store_; }
+const KeyIndex &TransactionManager::key_index() const { return key_index_; }
+const TidTable &TransactionManager::tid_table() const { return tids_; }
+uint32_t TransactionManager::invalid_read() const { return invalid_read_; }
 
-unique_ptr<Transaction> TransactionManager::init_transaction() { return make_unique<Transaction>(0, 0, 0); }
+HistoryPtr<Transaction> TransactionManager::init_transaction() { return HistoryPtr<Transaction>(new Transaction(0, 0, 0)); }
 
-bool TransactionManager::load(const string &root)
+template <typename Reader>
+static void parse_session(Reader &in, Session &session, HistoryAllocator &alloc)
 {
-    vector<vector<unique_ptr<Transaction>>> sessions;
+    SessionBuilder builder(session, alloc);
+    char opType;
+    while (in.next(opType))
+    {
+        uint64_t start_time, end_time, key, read_field, write_filed;
+        uint32_t tid, oid, from_tid, from_oid, left, right, value, size;
+
+        switch (opType)
+        {
+        case 'T':
+            in.read(tid);
+            in.read(start_time);
+            in.read(end_time);
+            builder.begin(tid, start_time, end_time);
+            break;
+        case 'S':
+            in.read(oid);
+            in.read(start_time);
+            in.read(end_time);
+            builder.append('S', oid, start_time, end_time);
+            break;
+        case 'C':
+            in.read(oid);
+            in.read(start_time);
+            in.read(end_time);
+            builder.commit(oid, start_time, end_time);
+            break;
+        case 'A':
+            in.read(oid);
+            in.read(start_time);
+            in.read(end_time);
+            builder.abort();
+            break;
+        case 'W':
+        {
+            in.read(oid);
+            in.read(start_time);
+            in.read(end_time);
+            in.read(key);
+            in.read(write_filed);
+            in.read(value);
+            PendingOperator &op = builder.append('W', oid, start_time, end_time);
+            op.key = key;
+            op.field = write_filed;
+            op.x = value;
+        }
+        break;
+        case 'R':
+        {
+            in.read(oid);
+            in.read(start_time);
+            in.read(end_time);
+            in.read(key);
+            in.read(from_tid);
+            in.read(from_oid);
+            PendingOperator &op = builder.append('R', oid, start_time, end_time);
+            op.key = key;
+            op.x = from_tid;
+            op.y = from_oid;
+        }
+        break;
+        case 'P':
+        {
+            in.read(oid);
+            in.read(start_time);
+            in.read(end_time);
+            in.read(read_field);
+            in.read(left);
+            in.read(right);
+            in.read(size);
+            PendingOperator &op = builder.append('P', oid, start_time, end_time);
+            op.field = read_field;
+            op.x = left;
+            op.y = right;
+            op.size = size;
+            op.offset = builder.keys().size();
 
+            for (size_t i = 0; i < size; ++i)
+            {
+                in.read(key);
+                builder.keys().push_back(key);
+            }
+            for (size_t i = 0; i < size; ++i)
+            {
+                in.read(from_tid);
+                builder.from_tids().push_back(from_tid);
+            }
+            for (size_t i = 0; i < size; ++i)
+            {
+                in.read(from_oid);
+                builder.from_oids().push_back(from_oid);
+            }
+        }
+        break;
+        default:
+            throw runtime_error("LOG ERROR: Unknown operation type");
+        }
+    }
+    builder.flush();
+}
+
+bool TransactionManager::list_logs(const string &root, vector<string> &paths, const string &suffix) const
+{
     DIR *dir = opendir(root.c_str());
     if (!dir)
     {
@@ -229,125 +581,164 @@ bool TransactionManager::load(const string &root)
 
         string full_path = root + "/" + filename;
         struct stat file_info;
-        if (stat(full_path.c_str(), &file_info) != 0 || !S_ISREG(file_info.st_mode) || filename.substr(filename.find_last_of('.')) != ".log")
+        size_t dot = filename.find_last_of('.');
+        if (stat(full_path.c_str(), &file_info) != 0 || !S_ISREG(file_info.st_mode) || dot == string::npos || filename.substr(dot) != suffix)
             continue;
+        paths.push_back(full_path);
+    }
+    closedir(dir);
+    return true;
+}
 
-        ifstream file(full_path, ios::binary);
-        if (!file)
-        {
-            continue;
-        }
+void TransactionManager::load_stream(const string &path, Session &session, HistoryAllocator &alloc)
+{
+    ifstream file(path, ios::binary);
+    if (!file)
+    {
+        return;
+    }
+    StreamReader reader(file);
+    parse_session(reader, session, alloc);
+}
 
-        vector<unique_ptr<Transaction>> session;
-        Transaction *trx = nullptr;
+void TransactionManager::load_mmap(const string &path, Session &session, HistoryAllocator &alloc)
+{
+    MappedFile file(path);
+    if (!file.valid())
+    {
+        return;
+    }
+    MappedReader reader(file.begin(), file.end());
+    parse_session(reader, session, alloc);
+}
 
-        char opType;
-        unordered_set<uint64_t> keys;
-        unordered_set<uint32_t> from_oids, from_tids;
+void TransactionManager::load_zlib(const string &path, Session &session, HistoryAllocator &alloc, DecodeStats &stats)
+{
+    BlockReader reader(path);
+    if (!reader.valid())
+    {
+        return;
+    }
+    parse_session(reader, session, alloc);
+    stats = reader.stats();
+}
 
-        while (file.read(&opType, 1))
-        {
-            uint64_t start_time, end_time, key, read_field, write_filed;
-            uint32_t tid, oid, from_tid, from_oid, left, right, value, size;
+// A v2 transaction ends at the next 'T' record or at the end of its session;
+// its rows are then [ops_begin, ops.size()) and must match its operator count.
+static void close_v2_transaction(Transaction &trx, const OperatorStore &ops, uint32_t ops_begin, uint32_t n_ops)
+{
+    if (ops.size() - ops_begin != n_ops)
+    {
+        throw runtime_error("LOG ERROR: Transaction does not match its operator count");
+    }
+    trx.set_ops_range(&ops, ops_begin, ops.size());
+}
 
-            switch (opType)
+void TransactionManager::load_v2(const HistoryIndex &index, size_t i, Session &session, HistoryAllocator &alloc)
+{
+    MappedReader in = index.session_reader(i);
+    session.trxs.reserve(min<uint64_t>(index.session(i).n_trxs, in.remaining() / HISTORY_V2_TRX_BYTES));
+    session.ops.reserve(min<uint64_t>(index.session(i).n_ops, in.remaining() / HISTORY_V2_OP_BYTES));
+    Transaction *trx = nullptr;
+    uint32_t ops_begin = 0;
+    uint32_t trx_ops = 0;
+    char opType;
+    while (in.next(opType))
+    {
+        uint64_t start_time, end_time, field;
+        uint32_t tid, oid, key, from_tid, from_oid, left, right, value, size, n_ops;
+
+        if (opType == 'T')
+        {
+            in.read(tid);
+            in.read(start_time);
+            in.read(end_time);
+            in.read(n_ops);
+            if (trx != nullptr)
             {
-            case 'T':
-                file.read(reinterpret_cast<char *>(&tid), sizeof(tid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                session.emplace_back(make_unique<Transaction>(tid, start_time, end_time));
-                trx = session.back().get();
-                break;
-            case 'S':
-                file.read(reinterpret_cast<char *>(&oid), sizeof(oid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                trx->append_operator(make_unique<Begin>(oid, start_time, end_time));
-                break;
-            case 'C':
-                file.read(reinterpret_cast<char *>(&oid), sizeof(oid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                trx->append_operator(make_unique<Commit>(oid, start_time, end_time));
-                if (trx->operators().size() > 1)
-                {
-                    trx->set_start(trx->operators()[1]->start());
-                }
-                break;
-            case 'A':
-                file.read(reinterpret_cast<char *>(&oid), sizeof(oid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                trx->append_operator(make_unique<Abort>(oid, start_time, end_time));
-                if (trx->operators().size() > 1)
-                {
-                    trx->set_start(trx->operators()[1]->start());
-                }
-                session.pop_back();
-                break;
-            case 'W':
-                file.read(reinterpret_cast<char *>(&oid), sizeof(oid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                file.read(reinterpret_cast<char *>(&key), sizeof(key));
-                file.read(reinterpret_cast<char *>(&write_filed), sizeof(write_filed));
-                file.read(reinterpret_cast<char *>(&value), sizeof(value));
-                trx->append_operator(make_unique<Write>(oid, start_time, end_time, key, write_filed, value));
-                break;
-            case 'R':
-                file.read(reinterpret_cast<char *>(&oid), sizeof(oid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                file.read(reinterpret_cast<char *>(&key), sizeof(key));
-                file.read(reinterpret_cast<char *>(&from_tid), sizeof(from_tid));
-                file.read(reinterpret_cast<char *>(&from_oid), sizeof(from_oid));
-                trx->append_operator(make_unique<Read>(oid, start_time, end_time, key, from_tid, from_oid));
-                break;
-            case 'P':
-                file.read(reinterpret_cast<char *>(&oid), sizeof(oid));
-                file.read(reinterpret_cast<char *>(&start_time), sizeof(start_time));
-                file.read(reinterpret_cast<char *>(&end_time), sizeof(end_time));
-                file.read(reinterpret_cast<char *>(&read_field), sizeof(read_field));
-                file.read(reinterpret_cast<char *>(&left), sizeof(left));
-                file.read(reinterpret_cast<char *>(&right), sizeof(right));
-                file.read(reinterpret_cast<char *>(&size), sizeof(size));
-
-                keys.clear();
-                from_tids.clear();
-                from_oids.clear();
-
-                keys.reserve(size);
-                from_tids.reserve(size);
-                from_oids.reserve(size);
-
-                for (size_t i = 0; i < size; ++i)
-                {
-                    file.read(reinterpret_cast<char *>(&key), sizeof(key));
-                    keys.insert(key);
-                }
-                for (size_t i = 0; i < size; ++i)
-                {
-                    file.read(reinterpret_cast<char *>(&from_tid), sizeof(from_tid));
-                    from_tids.insert(from_tid);
-                }
-                for (size_t i = 0; i < size; ++i)
-                {
-                    file.read(reinterpret_cast<char *>(&from_oid), sizeof(from_oid));
-                    from_oids.insert(from_oid);
-                }
-                trx->append_operator(make_unique<Predicate>(oid, start_time, end_time, read_field, left, right, keys, from_tids, from_oids));
-                break;
-            default:
-                throw runtime_error("LOG ERROR: Unknown operation type");
+                close_v2_transaction(*trx, session.ops, ops_begin, trx_ops);
             }
+            session.trxs.emplace_back(alloc.make<Transaction>(tid, start_time, end_time));
+            trx = session.trxs.back().get();
+            ops_begin = session.ops.size();
+            trx_ops = n_ops;
+            continue;
+        }
+        if (trx == nullptr)
+        {
+            throw runtime_error("LOG ERROR: Operation outside of a transaction");
+        }
+        in.read(oid);
+        in.read(start_time);
+        in.read(end_time);
+        switch (opType)
+        {
+        case 'S':
+            session.ops.append(OperatorType::BEGIN, oid, start_time, end_time);
+            break;
+        case 'C':
+            session.ops.append(OperatorType::COMMIT, oid, start_time, end_time);
+            break;
+        case 'W':
+            in.read(key);
+            in.read(field);
+            in.read(value);
+            session.ops.append_write(oid, start_time, end_time, index.key(key), field, value, key);
+            break;
+        case 'R':
+            in.read(key);
+            in.read(from_tid);
+            in.read(from_oid);
+            session.ops.append_read(oid, start_time, end_time, index.key(key), from_tid, from_oid, key);
+            break;
+        case 'P':
+        {
+            in.read(field);
+            in.read(left);
+            in.read(right);
+            vector<uint64_t> keys;
+            vector<uint32_t> from_tids, from_oids;
+            in.read(size);
+            keys.reserve(min<size_t>(size, in.remaining() / sizeof(uint32_t)));
+            for (uint32_t j = 0; j < size; ++j)
+            {
+                in.read(key);
+                keys.push_back(index.key(key));
+            }
+            in.read(size);
+            from_tids.reserve(min<size_t>(size, in.remaining() / sizeof(uint32_t)));
+            for (uint32_t j = 0; j < size; ++j)
+            {
+                in.read(from_tid);
+                from_tids.push_back(from_tid);
+            }
+            in.read(size);
+            from_oids.reserve(min<size_t>(size, in.remaining() / sizeof(uint32_t)));
+            for (uint32_t j = 0; j < size; ++j)
+            {
+                in.read(from_oid);
+                from_oids.push_back(from_oid);
+            }
+            session.ops.append_predicate(oid, start_time, end_time,
+                                         Predicate(field, left, right, move(keys), move(from_tids), move(from_oids)));
+        }
+        break;
+        default:
+            throw runtime_error("LOG ERROR: Unknown operation type");
         }
-        sessions.emplace_back(move(session));
     }
-    closedir(dir);
-    trxs_.clear();
-    trxs_.emplace_back(move(init_transaction()));
-    // priority_queue<pair<unique_ptr<Transaction>, int>, vector<pair<Transaction *, int>>, CompareTransactions> minHeap;
+    if (trx != nullptr)
+    {
+        close_v2_transaction(*trx, session.ops, ops_begin, trx_ops);
+    }
+    if (session.trxs.size() != index.session(i).n_trxs)
+    {
+        throw runtime_error("LOG ERROR: Session does not match the history index");
+    }
+}
+
+vector<uint32_t> TransactionManager::merge_order(const vector<Session> &sessions) const
+{
     using HeapElem = pair<Transaction *, int>;
 
     priority_queue<
@@ -356,23 +747,467 @@ bool TransactionManager::load(const string &root)
         CompareTransactions>
         minHeap;
     vector<size_t> indices(sessions.size(), 0);
+    vector<uint32_t> order;
 
     for (size_t i = 0; i < sessions.size(); ++i)
     {
-        if (!sessions[i].empty())
+        if (!sessions[i].trxs.empty())
         {
-            minHeap.emplace(sessions[i][0].get(), i);
+            minHeap.emplace(sessions[i].trxs[0].get(), i);
         }
     }
     while (!minHeap.empty())
     {
         int session_index = minHeap.top().second;
         minHeap.pop();
-        trxs_.emplace_back(move(sessions[session_index][indices[session_index]]));
-        if (++indices[session_index] < sessions[session_index].size())
+        order.push_back(session_index);
+        if (++indices[session_index] < sessions[session_index].trxs.size())
+        {
+            minHeap.emplace(sessions[session_index].trxs[indices[session_index]].get(), session_index);
+        }
+    }
+    return order;
+}
+
+// order[i] is the session the i-th transaction of the history is taken from;
+// the operators are copied into the history's store in the same order
+void TransactionManager::merge(vector<Session> &sessions, const vector<uint32_t> &order)
+{
+    size_t n_ops = 0;
+    for (const Session &session : sessions)
+    {
+        n_ops += session.ops.size();
+    }
+    store_.clear();
+    store_.reserve(n_ops);
+    trxs_.clear();
+    trxs_.reserve(order.size() + 1);
+    trxs_.emplace_back(move(init_transaction()));
+    trxs_.back()->set_ops_range(&store_, 0, 0);
+    vector<size_t> indices(sessions.size(), 0);
+    for (uint32_t session_index : order)
+    {
+        if (session_index >= sessions.size() || indices[session_index] >= sessions[session_index].trxs.size())
+        {
+            throw runtime_error("LOG ERROR: Time index does not match the sessions");
+        }
+        HistoryPtr<Transaction> &trx = sessions[session_index].trxs[indices[session_index]++];
+        uint32_t begin = store_.size();
+        store_.append(sessions[session_index].ops, trx->ops_begin(), trx->ops_end());
+        trx->set_ops_range(&store_, begin, store_.size());
+        trxs_.emplace_back(move(trx));
+    }
+}
+
+void TransactionManager::build_indexes()
+{
+    tids_.build(trxs_);
+    store_.intern_keys();
+    key_index_.build_installs(trxs_, store_);
+    invalid_read_ = store_.resolve_reads(tids_, key_index_);
+    key_index_.build_reads(trxs_, store_);
+}
+
+// Runs task(0) .. task(n - 1) on up to `threads` workers, handing the indices
+// out in order, and returns the number of workers used.
+static size_t run_parallel(size_t n, int threads, const function<void(size_t)> &task)
+{
+    size_t n_threads = min(static_cast<size_t>(max(threads, 1)), n);
+    if (n_threads <= 1)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            task(i);
+        }
+        return 1;
+    }
+    atomic<size_t> next(0);
+    vector<exception_ptr> errors(n_threads);
+    vector<thread> workers;
+    for (size_t t = 0; t < n_threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+                             {
+                                 try
+                                 {
+                                     for (size_t i = next++; i < n; i = next++)
+                                     {
+                                         task(i);
+                                     }
+                                 }
+                                 catch (...)
+                                 {
+                                     errors[t] = current_exception();
+                                 } });
+    }
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    for (const exception_ptr &error : errors)
+    {
+        if (error)
+        {
+            rethrow_exception(error);
+        }
+    }
+    return n_threads;
+}
+
+// a single-file history is given either as the file itself or as the directory holding it
+// a single-file history is given either as the file itself or as the directory holding it
+static string history_path(const string &log, const string &name)
+{
+    struct stat file_info;
+    if (stat(log.c_str(), &file_info) == 0 && S_ISDIR(file_info.st_mode))
+    {
+        return log + "/" + name;
+    }
+    return log;
+}
+
+bool TransactionManager::load(const VerifyOptions &options)
+{
+    vector<string> paths;
+    unique_ptr<MappedFile> history;
+    unique_ptr<HistoryIndex> index;
+    unique_ptr<DbcopHistory> dbcop;
+    if (options.loader == "v2")
+    {
+        history = make_unique<MappedFile>(history_path(options.log, "history.v2"));
+        if (!history->valid())
+        {
+            return false;
+        }
+        index = make_unique<HistoryIndex>(*history);
+        for (size_t i = 0; i < index->sessions(); ++i)
+        {
+            paths.push_back("session " + std::to_string(i));
+        }
+    }
+    else if (options.loader == "dbcop")
+    {
+        dbcop = make_unique<DbcopHistory>(history_path(options.log, "history.bincode"));
+        if (!dbcop->valid())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < dbcop->sessions(); ++i)
+        {
+            paths.push_back("session " + std::to_string(i));
+        }
+    }
+    else if (!list_logs(options.log, paths, options.loader == "zlib" ? ".zlog" : ".log"))
+    {
+        return false;
+    }
+
+    vector<Session> sessions(paths.size());
+    vector<long> parse_times(paths.size(), 0);
+    vector<DecodeStats> decode_stats(paths.size());
+    // one arena per session, so parsing threads never share an allocator
+    trxs_.clear();
+    arenas_.clear();
+    vector<HistoryAllocator> allocs;
+    allocs.reserve(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (options.arena)
+        {
+            arenas_.emplace_back(make_unique<Arena>());
+        }
+        allocs.emplace_back(options.arena ? arenas_.back().get() : nullptr);
+    }
+    auto parse = [&](size_t i)
+    {
+        auto parse_start = chrono::high_resolution_clock::now();
+        if (index)
+        {
+            load_v2(*index, i, sessions[i], allocs[i]);
+        }
+        else if (dbcop)
+        {
+            dbcop->load_session(i, sessions[i], allocs[i]);
+        }
+        else if (options.loader == "cobra")
+        {
+            load_cobra(paths[i], sessions[i], allocs[i]);
+        }
+        else if (options.loader == "mmap")
+        {
+            load_mmap(paths[i], sessions[i], allocs[i]);
+        }
+        else if (options.loader == "zlib")
+        {
+            load_zlib(paths[i], sessions[i], allocs[i], decode_stats[i]);
+        }
+        else
+        {
+            load_stream(paths[i], sessions[i], allocs[i]);
+        }
+        auto parse_end = chrono::high_resolution_clock::now();
+        parse_times[i] = chrono::duration_cast<chrono::microseconds>(parse_end - parse_start).count();
+    };
+
+    auto load_start = chrono::high_resolution_clock::now();
+    size_t n_threads = run_parallel(paths.size(), options.threads, parse);
+    auto parse_end = chrono::high_resolution_clock::now();
+    if (index && index->has_time_index())
+    {
+        vector<uint32_t> order(index->header().n_trxs);
+        for (size_t i = 0; i < order.size(); ++i)
         {
-            minHeap.emplace(sessions[session_index][indices[session_index]].get(), session_index);
+            order[i] = index->time(i).session;
         }
+        merge(sessions, order);
     }
+    else
+    {
+        merge(sessions, merge_order(sessions));
+    }
+    if (index)
+    {
+        // the rows carry the ids of the file's key dictionary already
+        store_.set_key_dict(index->keys());
+    }
+    build_indexes();
+    auto load_end = chrono::high_resolution_clock::now();
+
+    std::cout << "====================== Loading Statistics ======================\n";
+    std::cout << "Loader Threads:           " << n_threads << "\n";
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        std::cout << "  " << paths[i].substr(paths[i].find_last_of('/') + 1) << " Parse Time: " << parse_times[i] << " us\n";
+    }
+    std::cout << "Session Parsing Time Taken: " << chrono::duration_cast<chrono::microseconds>(parse_end - load_start).count() << " us\n";
+    std::cout << "Session Merging Time Taken: " << chrono::duration_cast<chrono::microseconds>(load_end - parse_end).count() << " us\n";
+    std::cout << "Loaded Transactions:        " << trxs_.size() - 1 << "\n";
+    if (options.loader == "zlib")
+    {
+        DecodeStats total;
+        for (const DecodeStats &stats : decode_stats)
+        {
+            total.packed_bytes += stats.packed_bytes;
+            total.raw_bytes += stats.raw_bytes;
+            total.decode_time += stats.decode_time;
+        }
+        std::cout << "Compressed Bytes:           " << total.packed_bytes << "\n";
+        std::cout << "Decompressed Bytes:         " << total.raw_bytes << "\n";
+        std::cout << "Compression Ratio:          " << (total.packed_bytes > 0 ? static_cast<double>(total.raw_bytes) / total.packed_bytes : 0.0) << "\n";
+        std::cout << "Block Decode Time Taken: " << total.decode_time << " us\n";
+        std::cout << "Decode Throughput:          " << (total.decode_time > 0 ? static_cast<double>(total.raw_bytes) / total.decode_time : 0.0) << " MB/s\n";
+    }
+    // transactions go through the allocator; the operators are rows of the
+    // session stores and of the history's store, plain vectors in both modes
+    size_t objects = 0, object_bytes = 0, system_allocs = 0, system_bytes = 0;
+    for (const HistoryAllocator &alloc : allocs)
+    {
+        objects += alloc.objects();
+        object_bytes += alloc.object_bytes();
+        system_allocs += alloc.system_allocs();
+        system_bytes += alloc.system_bytes();
+    }
+    size_t store_bytes = store_.bytes();
+    for (const Session &session : sessions)
+    {
+        store_bytes += session.ops.bytes();
+    }
+    std::cout << "History Allocator:          " << (options.arena ? "arena" : "heap") << "\n";
+    std::cout << "  Objects Built:            " << objects << "\n";
+    std::cout << "  Object Bytes:             " << object_bytes << "\n";
+    std::cout << "  System Allocations:       " << system_allocs << "\n";
+    std::cout << "  System Allocated Bytes:   " << system_bytes << "\n";
+    std::cout << "  Operator Store Bytes:     " << store_bytes << "\n";
+    std::cout << "  Total History Bytes:      " << system_bytes + store_bytes << "\n";
     return true;
-}
\ No newline at end of file
+}
+
+template <typename T>
+static void put(ostream &out, const T &value)
+{
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void put_header(ostream &out, char type, const OperatorStore &ops, uint32_t k)
+{
+    put(out, type);
+    put(out, ops.oid(k));
+    put(out, ops.start(k));
+    put(out, ops.end(k));
+}
+
+bool TransactionManager::convert(const VerifyOptions &options, const string &target, bool time_index)
+{
+    vector<string> paths;
+    if (!list_logs(options.log, paths))
+    {
+        return false;
+    }
+    vector<Session> sessions(paths.size());
+    vector<HistoryAllocator> allocs(paths.size());
+    run_parallel(paths.size(), options.threads, [&](size_t i)
+                 {
+                     if (options.loader == "mmap")
+                     {
+                         load_mmap(paths[i], sessions[i], allocs[i]);
+                     }
+                     else
+                     {
+                         load_stream(paths[i], sessions[i], allocs[i]);
+                     } });
+
+    // key dictionary: every key a record refers to, in ascending order
+    vector<uint64_t> keys;
+    for (const Session &session : sessions)
+    {
+        for (uint32_t k = 0; k < session.ops.size(); ++k)
+        {
+            OperatorType type = session.ops.type(k);
+            if (type == OperatorType::WRITE || type == OperatorType::READ)
+            {
+                keys.push_back(session.ops.key(k));
+            }
+            else if (type == OperatorType::PREDICATE)
+            {
+                const vector<uint64_t> &pred_keys = session.ops.predicate(k).keys();
+                keys.insert(keys.end(), pred_keys.begin(), pred_keys.end());
+            }
+        }
+    }
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+    if (keys.size() > UINT32_MAX)
+    {
+        throw runtime_error("LOG ERROR: Too many keys for a v2 history");
+    }
+    unordered_map<uint64_t, uint32_t> key_ids;
+    key_ids.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        key_ids[keys[i]] = i;
+    }
+
+    ofstream out(target, ios::binary | ios::trunc);
+    if (!out)
+    {
+        return false;
+    }
+    HistoryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HISTORY_V2_MAGIC, sizeof(header.magic));
+    header.version = HISTORY_V2_VERSION;
+    header.endian = HISTORY_V2_ENDIAN;
+    header.flags = time_index ? HISTORY_V2_TIME_INDEX : 0;
+    header.n_sessions = sessions.size();
+    header.n_keys = keys.size();
+    put(out, header);
+
+    header.keys_offset = out.tellp();
+    out.write(reinterpret_cast<const char *>(keys.data()), keys.size() * sizeof(uint64_t));
+
+    vector<SessionEntry> entries(sessions.size());
+    for (size_t i = 0; i < sessions.size(); ++i)
+    {
+        SessionEntry &entry = entries[i];
+        entry.offset = out.tellp();
+        entry.n_trxs = sessions[i].trxs.size();
+        entry.n_ops = 0;
+        const OperatorStore &ops = sessions[i].ops;
+        for (const HistoryPtr<Transaction> &trx : sessions[i].trxs)
+        {
+            put(out, 'T');
+            put(out, trx->tid());
+            put(out, trx->start());
+            put(out, trx->end());
+            put(out, trx->ops_end() - trx->ops_begin());
+            entry.n_ops += trx->ops_end() - trx->ops_begin();
+            for (uint32_t k = trx->ops_begin(); k < trx->ops_end(); ++k)
+            {
+                switch (ops.type(k))
+                {
+                case OperatorType::BEGIN:
+                    put_header(out, 'S', ops, k);
+                    break;
+                case OperatorType::COMMIT:
+                    put_header(out, 'C', ops, k);
+                    break;
+                case OperatorType::WRITE:
+                    put_header(out, 'W', ops, k);
+                    put(out, key_ids[ops.key(k)]);
+                    put(out, ops.update(k).field);
+                    put(out, ops.update(k).value);
+                    break;
+                case OperatorType::READ:
+                    put_header(out, 'R', ops, k);
+                    put(out, key_ids[ops.key(k)]);
+                    put(out, ops.from_tid(k));
+                    put(out, ops.from_oid(k));
+                    break;
+                case OperatorType::PREDICATE:
+                {
+                    const Predicate &pred = ops.predicate(k);
+                    put_header(out, 'P', ops, k);
+                    put(out, pred.field());
+                    put(out, pred.left_bound());
+                    put(out, pred.right_bound());
+                    put(out, static_cast<uint32_t>(pred.keys().size()));
+                    for (uint64_t key : pred.keys())
+                    {
+                        put(out, key_ids[key]);
+                    }
+                    put(out, static_cast<uint32_t>(pred.from_tids().size()));
+                    for (uint32_t from_tid : pred.from_tids())
+                    {
+                        put(out, from_tid);
+                    }
+                    put(out, static_cast<uint32_t>(pred.from_oids().size()));
+                    for (uint32_t from_oid : pred.from_oids())
+                    {
+                        put(out, from_oid);
+                    }
+                }
+                break;
+                default:
+                    break;
+                }
+            }
+        }
+        entry.size = static_cast<uint64_t>(out.tellp()) - entry.offset;
+        header.n_trxs += entry.n_trxs;
+        header.n_ops += entry.n_ops;
+    }
+
+    header.sessions_offset = out.tellp();
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(SessionEntry));
+
+    if (time_index)
+    {
+        header.time_index_offset = out.tellp();
+        vector<size_t> indices(sessions.size(), 0);
+        for (uint32_t session_index : merge_order(sessions))
+        {
+            TimeIndexEntry entry{sessions[session_index].trxs[indices[session_index]++]->start(), session_index, 0};
+            put(out, entry);
+        }
+    }
+
+    out.seekp(0);
+    put(out, header);
+    return static_cast<bool>(out);
+}
+
+bool TransactionManager::compress(const VerifyOptions &options, const string &target, uint32_t block_size, int level)
+{
+    vector<string> paths;
+    if (!list_logs(options.log, paths))
+    {
+        return false;
+    }
+    vector<char> compressed(paths.size(), false);
+    run_parallel(paths.size(), options.threads, [&](size_t i)
+                 {
+                     string name = paths[i].substr(paths[i].find_last_of('/') + 1);
+                     name = name.substr(0, name.find_last_of('.')) + ".zlog";
+                     compressed[i] = compress_log(paths[i], target + "/" + name, block_size, level); });
+    return find(compressed.begin(), compressed.end(), false) == compressed.end();
+}
@@ -3,6 +3,7 @@
 
 #define INIT_TID 0
 #define INIT_OID 0
+#define NO_KEY_ID UINT32_MAX
 
 #include <cassert>
 #include <vector>
@@ -14,8 +15,14 @@
 #include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
-enum class OperatorType
+#include "options.h"
+#include "transaction/arena.h"
+#include "transaction/history_v2.h"
+#include "transaction/key_index.h"
+
+enum class OperatorType : uint8_t
 {
     READ,
     WRITE,
@@ -25,141 +32,116 @@ enum class OperatorType
     PREDICATE,
 };
 
-class Operator
+struct FieldUpdate
 {
-public:
-    Operator(uint32_t oid, uint64_t start, uint64_t end);
-    virtual ~Operator() = default;
-    virtual OperatorType type() const = 0;
-
-    uint32_t oid() const;
-    uint64_t start() const;
-    uint64_t end() const;
-
-    virtual std::string to_string() const = 0;
-
-protected:
-    uint32_t oid_;
-    uint64_t start_;
-    uint64_t end_;
+    uint64_t field;
+    uint32_t value;
 };
 
-class Read : public Operator
+// Contiguous run of field updates, sorted by field.
+class UpdateRange
 {
 public:
-    Read(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint32_t from_tid, uint32_t from_oid);
-    OperatorType type() const override;
-
-    uint64_t key() const;
-    uint32_t from_tid() const;
-    uint32_t from_oid() const;
+    UpdateRange(const FieldUpdate *begin, const FieldUpdate *end) : begin_(begin), end_(end) {}
 
-    std::string to_string() const override;
+    const FieldUpdate *begin() const { return begin_; }
+    const FieldUpdate *end() const { return end_; }
+    size_t size() const { return end_ - begin_; }
 
 private:
-    uint64_t key_;
-    uint32_t from_tid_;
-    uint32_t from_oid_;
+    const FieldUpdate *begin_;
+    const FieldUpdate *end_;
 };
 
-class Write : public Operator
+// Field updates of one transaction to one key: a single write's, or those of all
+// its writes to the key once combined, the later write winning a field.
+class Write
 {
 public:
-    Write(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint64_t field, uint32_t value);
-    OperatorType type() const override;
+    Write(uint32_t row, uint32_t oid, const FieldUpdate &update);
 
-    uint64_t key() const;
-    std::unordered_map<uint64_t, u_int32_t> updates();
+    uint32_t row() const; // OperatorStore row of the first write
+    uint32_t oid() const; // oid of the last write combined in
+    UpdateRange updates() const;
+    const FieldUpdate *find(uint64_t field) const; // nullptr if the field is not updated
 
-    void combine(Write *other);
-    std::string to_string() const override;
+    void combine(const Write &other);
 
 private:
-    uint64_t key_;
-    std::unordered_set<uint64_t> fields_;
-    std::unordered_set<uint32_t> values_;
-    std::unordered_map<uint64_t, u_int32_t> updates_; // field->value
-};
+    void insert(const FieldUpdate &update);
 
-class Begin : public Operator
-{
-public:
-    Begin(uint32_t oid, uint64_t start, uint64_t end);
-    OperatorType type() const override;
-
-    std::string to_string() const override;
-};
-
-class Commit : public Operator
-{
-public:
-    Commit(uint32_t oid, uint64_t start, uint64_t end);
-    OperatorType type() const override;
-
-    std::string to_string() const override;
-};
-
-class Abort : public Operator
-{
-public:
-    Abort(uint32_t oid, uint64_t start, uint64_t end);
-    OperatorType type() const override;
-
-    std::string to_string() const override;
+private:
+    uint32_t row_;
+    uint32_t oid_;
+    // a logged write updates one field; only combined writes spill into the vector
+    FieldUpdate update_;
+    std::vector<FieldUpdate> spilled_;
 };
 
-class Predicate : public Operator
+// Payload of a predicate read, kept in the side table of its OperatorStore.
+class Predicate
 {
 public:
-    Predicate(uint32_t oid, uint64_t start, uint64_t end, uint64_t field, uint32_t left_bound, uint32_t right_bound,
-              std::unordered_set<uint64_t> keys, std::unordered_set<uint32_t> from_tids, std::unordered_set<uint32_t> from_oids);
-
-    OperatorType type() const override;
-    const std::unordered_set<uint64_t> &keys() const;
-    const std::unordered_set<uint32_t> &from_tids() const;
-    const std::unordered_set<uint32_t> &from_oids() const;
-
-    bool relevant(Write *write) const;
-    bool match(Write *write) const;
+    Predicate(uint64_t field, uint32_t left_bound, uint32_t right_bound,
+              std::vector<uint64_t> keys, std::vector<uint32_t> from_tids, std::vector<uint32_t> from_oids);
+
+    // result sets, sorted and without duplicates
+    const std::vector<uint64_t> &keys() const;
+    const std::vector<uint32_t> &from_tids() const;
+    const std::vector<uint32_t> &from_oids() const;
+    uint64_t field() const;
+    uint32_t left_bound() const;
+    uint32_t right_bound() const;
+
+    bool relevant(const Write *write) const;
+    bool match(const Write *write) const;
     bool cover(uint64_t key) const;
-    std::string to_string() const override;
 
 private:
     uint64_t field_;
-    std::unordered_set<uint64_t> keys_;
-    std::unordered_set<uint32_t> from_tids_;
-    std::unordered_set<uint32_t> from_oids_;
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> from_tids_;
+    std::vector<uint32_t> from_oids_;
     uint32_t left_bound_;
     uint32_t right_bound_;
     friend class UnitedPredicate;
 };
 
+// Union of the predicates of one transaction. Refers to the predicates' key
+// arrays instead of copying them, so it must not outlive them.
 class UnitedPredicate
 {
 public:
     UnitedPredicate() = default;
-    void add(Predicate *p);
-    bool cover(uint64_t key);
-    bool relevant(Write *write);
-    bool match(Write *write);
+    void add(const Predicate *p);
+    bool cover(uint64_t key) const;
+    bool relevant(const Write *write) const;
+    bool match(const Write *write) const;
+    // true if one interval of the field holds all of [low, high]
+    bool contains(uint64_t field, uint32_t low, uint32_t high) const;
 
 private:
-    std::unordered_set<uint64_t> fields_;
-    std::unordered_set<uint64_t> keys_;
-    std::unordered_set<uint32_t> from_tids_;
-    std::unordered_set<uint32_t> from_oids_;
-    std::unordered_map<uint64_t, std::vector<std::pair<uint32_t, uint32_t>>> bounds_;
+    struct Bound
+    {
+        uint64_t field;
+        uint32_t left;
+        uint32_t right;
+    };
+    static bool field_less(const Bound &bound, uint64_t field) { return bound.field < field; }
+
+    std::vector<const std::vector<uint64_t> *> keys_;
+    std::vector<uint64_t> fields_; // sorted
+    std::vector<Bound> bounds_;    // disjoint per field, sorted by (field, left)
 };
 
+class OperatorStore;
+
 class Transaction
 {
 public:
     Transaction(uint32_t tid, uint64_t start, uint64_t end);
     ~Transaction() = default;
 
-    void append_operator(std::unique_ptr<Operator> operateor);
-    const std::vector<std::unique_ptr<Operator>> &operators() const;
-
     uint32_t tid() const;
     uint64_t start() const;
     uint64_t end() const;
@@ -167,6 +149,12 @@ public:
     void set_start(uint64_t start);
     void set_end(uint64_t end);
 
+    // the operators are the rows [ops_begin(), ops_end()) of operators()
+    const OperatorStore *operators() const;
+    uint32_t ops_begin() const;
+    uint32_t ops_end() const;
+    void set_ops_range(const OperatorStore *ops, uint32_t begin, uint32_t end);
+
     std::string to_string() const;
 
 private:
@@ -175,7 +163,94 @@ private:
     uint32_t tid_;
     uint64_t start_;
     uint64_t end_;
-    std::vector<std::unique_ptr<Operator>> operators_;
+    const OperatorStore *ops_ = nullptr;
+    uint32_t ops_begin_ = 0;
+    uint32_t ops_end_ = 0;
+};
+
+// Transaction id -> position in the loaded history. Direct-indexed when the
+// ids are dense enough, otherwise a sorted table searched by bisection.
+class TidTable
+{
+public:
+    void build(const std::vector<HistoryPtr<Transaction>> &trxs);
+    uint32_t find(uint32_t tid) const; // UINT32_MAX if no loaded transaction has the id
+
+private:
+    std::vector<uint32_t> direct_;
+    std::vector<std::pair<uint32_t, uint32_t>> sorted_;
+};
+
+// Every operator of a session or of the whole history, one row each, in
+// transaction order. Common fields are columns; the field update of a write
+// and the payload of a predicate live in side tables.
+class OperatorStore
+{
+public:
+    void reserve(size_t n);
+    void clear();
+    size_t size() const;
+    size_t bytes() const; // capacity of the columns and side tables
+
+    // BEGIN, COMMIT and ABORT rows
+    void append(OperatorType type, uint32_t oid, uint64_t start, uint64_t end);
+    // key_id is only known when the rows come with a key dictionary, see set_key_dict()
+    void append_read(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint32_t from_tid, uint32_t from_oid, uint32_t key_id = NO_KEY_ID);
+    void append_write(uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint64_t field, uint32_t value, uint32_t key_id = NO_KEY_ID);
+    void append_predicate(uint32_t oid, uint64_t start, uint64_t end, Predicate predicate);
+    // appends rows [begin, end) of `other`
+    void append(const OperatorStore &other, uint32_t begin, uint32_t end);
+
+    // numbers the keys densely, in order of first appearance, unless a
+    // dictionary was adopted with set_key_dict()
+    void intern_keys();
+    // adopts `dict` (key id -> key) for rows appended with their key ids
+    void set_key_dict(std::vector<uint64_t> dict);
+    // looks up the writer of every read once and checks that it installed the
+    // version read; returns the first read that fails, UINT32_MAX if none does
+    uint32_t resolve_reads(const TidTable &tids, const KeyIndex &index);
+    size_t key_count() const;
+    uint64_t key_of(uint32_t id) const { return key_dict_[id]; }
+
+    OperatorType type(uint32_t k) const { return types_[k]; }
+    uint32_t oid(uint32_t k) const { return oids_[k]; }
+    uint64_t start(uint32_t k) const { return starts_[k]; }
+    uint64_t end(uint32_t k) const { return ends_[k]; }
+    uint64_t key(uint32_t k) const { return keys_[k]; }
+    uint32_t key_id(uint32_t k) const { return key_ids_[k]; }
+    uint32_t from_tid(uint32_t k) const { return from_tids_[k]; }
+    uint32_t from_oid(uint32_t k) const { return from_oids_[k]; }
+    uint32_t from_vertex(uint32_t k) const { return from_vertices_[k]; } // UINT32_MAX if the writer is not loaded
+
+    const FieldUpdate &update(uint32_t k) const { return updates_[payloads_[k]]; }        // WRITE
+    Write write(uint32_t k) const { return Write(k, oids_[k], update(k)); }              // WRITE
+    const Predicate &predicate(uint32_t k) const { return predicates_[payloads_[k]]; } // PREDICATE
+    std::string to_string(uint32_t k) const;
+
+private:
+    void push_row(OperatorType type, uint32_t oid, uint64_t start, uint64_t end, uint64_t key, uint32_t key_id, uint32_t from_tid, uint32_t from_oid, uint32_t payload);
+
+private:
+    std::vector<OperatorType> types_;
+    std::vector<uint32_t> oids_;
+    std::vector<uint64_t> starts_;
+    std::vector<uint64_t> ends_;
+    std::vector<uint64_t> keys_;      // READ, WRITE
+    std::vector<uint32_t> key_ids_;   // READ, WRITE
+    std::vector<uint32_t> from_tids_; // READ
+    std::vector<uint32_t> from_oids_; // READ
+    std::vector<uint32_t> from_vertices_; // READ
+    std::vector<uint32_t> payloads_;  // WRITE: index in updates_, PREDICATE: index in predicates_
+    std::vector<FieldUpdate> updates_;
+    std::vector<Predicate> predicates_;
+    std::vector<uint64_t> key_dict_; // key id -> key
+};
+
+// Transactions of one session as parsed, with their operators.
+struct Session
+{
+    std::vector<HistoryPtr<Transaction>> trxs;
+    OperatorStore ops;
 };
 
 struct CompareTransactions
@@ -191,12 +266,33 @@ class TransactionManager
 public:
     TransactionManager();
     ~TransactionManager() = default;
-    const std::vector<std::unique_ptr<Transaction>> &transactions() const;
-    std::unique_ptr<Transaction> init_transaction();
-    bool load(const std::string &root);
+    const std::vector<HistoryPtr<Transaction>> &transactions() const;
+    const OperatorStore &operator_store() const;
+    const KeyIndex &key_index() const;
+    const TidTable &tid_table() const;
+    uint32_t invalid_read() const;
+    HistoryPtr<Transaction> init_transaction();
+    bool load(const VerifyOptions &options);
+    bool convert(const VerifyOptions &options, const std::string &target, bool time_index);
+    bool compress(const VerifyOptions &options, const std::string &target, uint32_t block_size, int level);
+
+private:
+    bool list_logs(const std::string &root, std::vector<std::string> &paths, const std::string &suffix = ".log") const;
+    void load_stream(const std::string &path, Session &session, HistoryAllocator &alloc);
+    void load_mmap(const std::string &path, Session &session, HistoryAllocator &alloc);
+    void load_zlib(const std::string &path, Session &session, HistoryAllocator &alloc, DecodeStats &stats);
+    void load_v2(const HistoryIndex &index, size_t i, Session &session, HistoryAllocator &alloc);
+    std::vector<uint32_t> merge_order(const std::vector<Session> &sessions) const;
+    void merge(std::vector<Session> &sessions, const std::vector<uint32_t> &order);
+    void build_indexes();
 
 private:
-    std::vector<std::unique_ptr<Transaction>> trxs_;
+    std::vector<std::unique_ptr<Arena>> arenas_; // must outlive trxs_
+    std::vector<HistoryPtr<Transaction>> trxs_;
+    OperatorStore store_;
+    TidTable tids_;
+    KeyIndex key_index_;
+    uint32_t invalid_read_ = UINT32_MAX; // first aborted or intermediate read
     std::unique_ptr<Transaction> init_trx_;
 };
 
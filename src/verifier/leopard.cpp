@@ -3,23 +3,16 @@
 using DSG::Edge;
 using namespace std;
 
-size_t ReadManager::size() const { return reads_.size(); }
-void ReadManager::insert(const Read *read) { reads_.insert(read); }
-void ReadManager::remove(const Read *read)
+size_t ReadManager::size() const { return starts_.size(); }
+void ReadManager::insert(uint64_t start) { starts_.insert(start); }
+void ReadManager::remove(uint64_t start) { starts_.erase(start); }
+uint64_t ReadManager::min() const
 {
-    auto it = reads_.find(read);
-    if (it != reads_.end())
+    if (!starts_.empty())
     {
-        reads_.erase(it);
+        return *starts_.begin();
     }
-}
-const Read *ReadManager::min() const
-{
-    if (!reads_.empty())
-    {
-        return *reads_.begin();
-    }
-    return nullptr;
+    return UINT64_MAX;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -27,20 +20,26 @@ const Read *ReadManager::min() const
 Leopard::Leopard(const VerifyOptions &options)
 {
 
-    trx_manager_.load(options.log);
+    trx_manager_.load(options);
     int i = 0;
-    for (const unique_ptr<Transaction> &trx : trx_manager_.transactions())
+    for (const HistoryPtr<Transaction> &trx : trx_manager_.transactions())
     {
         vertices_.emplace_back(trx.get(), i);
         i++;
     }
     n_ = i;
+    size_t n_keys = trx_manager_.operator_store().key_count();
+    active_install_.resize(n_keys);
+    min_reads_.resize(n_keys);
+    version_order_.resize(n_keys);
+    replacement_time_.resize(n_keys);
 }
 
 bool Leopard::run()
 {
     try
     {
+        const OperatorStore &ops = trx_manager_.operator_store();
         vector<uint32_t> actives_vectices;
         for (uint32_t i = 0; i < n_; ++i)
         {
@@ -51,23 +50,17 @@ bool Leopard::run()
 
             Vertex &v = vertices_[i];
             Transaction *trx = v.transaction();
-            for (const unique_ptr<Operator> &op : trx->operators())
+            for (uint32_t k = trx->ops_begin(); k < trx->ops_end(); ++k)
             {
-                switch (op->type())
+                switch (ops.type(k))
                 {
                 case OperatorType::READ:
-                {
-                    Read *read = static_cast<Read *>(op.get());
-                    reads_[i].push_back(read);
-                    min_reads_[read->key()].insert(read);
-                }
-                break;
+                    reads_[i].push_back(k);
+                    min_reads_[ops.key_id(k)].insert(ops.start(k));
+                    break;
                 case OperatorType::WRITE:
-                {
-                    Write *write = static_cast<Write *>(op.get());
-                    v.set_write(write->key(), write);
-                }
-                break;
+                    v.set_write(ops.key_id(k), ops.write(k));
+                    break;
                 default:
                     break;
                 }
@@ -107,9 +100,8 @@ bool Leopard::run()
     }
 }
 
-vector<uint32_t> Leopard::candidate(Read *read, Vertex &r_trx)
+vector<uint32_t> Leopard::candidate(uint32_t key, Vertex &r_trx)
 {
-    uint64_t key = read->key();
     vector<uint32_t> candidates;
     Vertex *pivot = nullptr;
     const vector<uint32_t> &key_installer = active_install_[key];
@@ -145,19 +137,20 @@ void Leopard::consistent_read(uint32_t j)
     {
         return;
     }
-    const vector<Read *> reads = reads_.at(j);
-    for (Read *read : reads)
+    const OperatorStore &ops = trx_manager_.operator_store();
+    const vector<uint32_t> &reads = reads_.at(j);
+    for (uint32_t k : reads)
     {
-        uint64_t key = read->key();
-        if (read->from_oid() != 0)
+        uint32_t key = ops.key_id(k);
+        if (ops.from_oid(k) != 0)
         {
-            vector<uint32_t> candidates = candidate(read, vertices_[j]);
+            vector<uint32_t> candidates = candidate(key, vertices_[j]);
             bool find = false;
             for (uint32_t i : candidates)
             {
                 Vertex &w_trx = vertices_[i];
-                Write *write = w_trx.writes().at(key);
-                if (read->from_oid() == write->oid())
+                const Write *write = w_trx.write(key);
+                if (ops.from_oid(k) == write->oid())
                 {
                     w_trx.set_read(key, j);
                     wr_edges_.push_back(::Edge(i, j));
@@ -166,10 +159,10 @@ void Leopard::consistent_read(uint32_t j)
             }
             if (find == false)
             {
-                throw InconsistentReads(read);
+                throw InconsistentReads(ops.to_string(k));
             }
         }
-        min_reads_[key].remove(read);
+        min_reads_[key].remove(ops.start(k));
     }
 }
 
@@ -178,7 +171,7 @@ void Leopard::sort_write(uint32_t j)
     Vertex &v = vertices_[j];
     for (auto &write : v.writes())
     {
-        uint64_t key = write.first;
+        uint32_t key = write.first;
         // Write *v_write = write.second;
 
         auto active_it = active_install_[key].begin();
@@ -189,8 +182,7 @@ void Leopard::sort_write(uint32_t j)
 
             if (replacement_time_[key][i] <= v.start())
             {
-                auto it = min_reads_.find(key);
-                if (it == min_reads_.end() || min_reads_[key].size() == 0 || replacement_time_[key][i] <= min_reads_[key].min()->start())
+                if (min_reads_[key].size() == 0 || replacement_time_[key][i] <= min_reads_[key].min())
                 {
                     garbage_[key].insert(i);
                     ++active_it;
@@ -246,11 +238,12 @@ void Leopard::garbage_collection()
 
 void Leopard::first_updater_win(uint32_t j)
 {
+    const OperatorStore &ops = trx_manager_.operator_store();
     Vertex &v = vertices_[j];
     for (auto &install : v.writes())
     {
-        uint64_t key = install.first;
-        Write *v_write = install.second;
+        uint32_t key = install.first;
+        const Write &v_write = install.second;
         auto it = version_order_[key].begin();
         auto pos = version_order_[key].begin();
 
@@ -258,12 +251,12 @@ void Leopard::first_updater_win(uint32_t j)
         {
             uint32_t i = *it;
             Vertex &u = vertices_[i];
-            Write *u_write = u.writes().at(key);
+            const Write &u_write = *u.write(key);
 
-            uint64_t v_begin_end = v_write->end();
-            uint64_t v_commit_start = v.transaction()->operators().back()->start();
-            uint64_t u_begin_end = u_write->end();
-            uint64_t u_commit_start = u.transaction()->operators().back()->start();
+            uint64_t v_begin_end = ops.end(v_write.row());
+            uint64_t v_commit_start = ops.start(v.transaction()->ops_end() - 1);
+            uint64_t u_begin_end = ops.end(u_write.row());
+            uint64_t u_commit_start = ops.start(u.transaction()->ops_end() - 1);
             if (u_commit_start <= v_begin_end)
             {
                 pos = ++it;
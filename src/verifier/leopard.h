@@ -7,25 +7,18 @@
 #include "graph/graph.h"
 #include "options.h"
 
-struct ReadComparator
-{
-    bool operator()(const Read *lhs, const Read *rhs) const
-    {
-        return lhs->start() < rhs->start();
-    }
-};
-
+// start times of the active reads of one key
 class ReadManager
 {
 public:
     ReadManager() = default;
     size_t size() const;
-    void insert(const Read *read);
-    void remove(const Read *read);
-    const Read *min() const;
+    void insert(uint64_t start);
+    void remove(uint64_t start);
+    uint64_t min() const; // UINT64_MAX if there is no read
 
 private:
-    std::set<const Read *, ReadComparator> reads_;
+    std::set<uint64_t> starts_;
 };
 
 class Leopard
@@ -37,7 +30,7 @@ public:
 
 private:
     void consistent_read(uint32_t i);
-    std::vector<uint32_t> candidate(Read *read, Vertex &r_trx_);
+    std::vector<uint32_t> candidate(uint32_t key, Vertex &r_trx_);
     void sort_write(uint32_t i);
     void first_updater_win(uint32_t i);
     void ssi_certifier();
@@ -48,17 +41,18 @@ private:
     TransactionManager trx_manager_;
     std::vector<Vertex> vertices_;
     size_t n_;
-    std::unordered_map<uint32_t, std::vector<Read *>> reads_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> reads_; // vertex->rows of its reads
     std::unordered_map<uint32_t, uint32_t> anti_in_;
     std::unordered_map<uint32_t, uint32_t> anti_out_;
-    std::unordered_map<uint64_t, std::vector<uint32_t>> active_install_;
+    // per-key state, indexed by OperatorStore::key_id()
+    std::vector<std::vector<uint32_t>> active_install_;
     std::vector<DSG::Edge> ww_edges_;
     std::vector<DSG::Edge> wr_edges_;
     std::vector<DSG::Edge> rw_edges_;
-    std::unordered_map<uint64_t, ReadManager> min_reads_;
-    std::unordered_map<uint64_t, std::list<uint32_t>> version_order_;
-    std::unordered_map<uint64_t, std::unordered_map<uint32_t, uint64_t>> replacement_time_;
-    std::unordered_map<uint64_t, std::unordered_set<uint32_t>> garbage_;
+    std::vector<ReadManager> min_reads_;
+    std::vector<std::list<uint32_t>> version_order_;
+    std::vector<std::unordered_map<uint32_t, uint64_t>> replacement_time_;
+    std::unordered_map<uint32_t, std::unordered_set<uint32_t>> garbage_;
 };
 
 #endif
\ No newline at end of file
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <chrono>
+#include <thread>
 
 #include "vbox.h"
 #include "exception/isolation_exceptions.h"
@@ -31,12 +33,11 @@ using namespace std;
 
 Vbox::Vbox(const VerifyOptions &options) : options_(options)
 {
-    trx_manager_.load(options.log);
+    trx_manager_.load(options);
     int i = 0;
-    for (const unique_ptr<Transaction> &trx : trx_manager_.transactions())
+    for (const HistoryPtr<Transaction> &trx : trx_manager_.transactions())
     {
         vertices_.emplace_back(trx.get(), i, i, UINT32_MAX);
-        tid2index_[trx->tid()] = i;
         i++;
     }
     n_ = i;
@@ -204,12 +205,12 @@ void Vbox::merge_item_constraint(ItemConstraint &cst)
 
 void Vbox::generate_item_constraint()
 {
+    const KeyIndex &index = trx_manager_.key_index();
     if (!options_.time)
     {
-        for (auto &entry : installs_)
+        for (uint32_t key = 0; key < index.size(); ++key)
         {
-            uint64_t key = entry.first;
-            set<uint32_t> &key_installers = entry.second;
+            VertexRange key_installers = index.installers(key);
             vector<uint32_t> active_vertices;
             for (uint32_t j : key_installers)
             {
@@ -220,27 +221,19 @@ void Vbox::generate_item_constraint()
                     item_csts_.emplace_back(make_unique<ItemConstraint>(j, i));
                     ItemConstraint &item_cst = *item_csts_.back();
                     //(u -> v)
-                    if (u.reads().count(key) > 0)
+                    for (uint32_t k : index.readers(key, u.index()))
                     {
-                        const unordered_set<uint32_t> &read_from_u = u.reads().at(key);
-                        for (uint32_t k : read_from_u)
+                        if (i != k && i < vertices_[k].right())
                         {
-                            if (i != k && i < vertices_[k].right())
-                            {
-                                item_cst.insert_alpha(k, i);
-                            }
+                            item_cst.insert_alpha(k, i);
                         }
                     }
                     //(v -> u)
-                    if (v.reads().count(key) > 0)
+                    for (uint32_t k : index.readers(key, v.index()))
                     {
-                        const unordered_set<uint32_t> &read_from_v = v.reads().at(key);
-                        for (uint32_t k : read_from_v)
+                        if (j != k && j < vertices_[k].right())
                         {
-                            if (j != k && j < vertices_[k].right())
-                            {
-                                item_cst.insert_beta(k, j);
-                            }
+                            item_cst.insert_beta(k, j);
                         }
                     }
 
@@ -265,11 +258,9 @@ void Vbox::generate_item_constraint()
 
     else
     {
-        for (auto &entry : installs_)
+        for (uint32_t key = 0; key < index.size(); ++key)
         {
-
-            uint64_t key = entry.first;
-            set<uint32_t> &key_installers = entry.second;
+            VertexRange key_installers = index.installers(key);
             vector<uint32_t> active_vertices;
             unordered_map<uint32_t, uint64_t> replacement_time;
             total_item_cst_num_ += ((key_installers.size() + 1) * (key_installers.size()) / 2);
@@ -292,16 +283,12 @@ void Vbox::generate_item_constraint()
                     else if (u.end() <= v.start()) // item-write-dependency (u -> v)
                     {
                         ++active_it;
-                        if (u.reads().count(key) > 0)
+                        for (uint32_t k : index.readers(key, u.index())) // item-read-depends on u with respect to key
                         {
-                            const unordered_set<uint32_t> &read_from_u = u.reads().at(key);
-                            for (uint32_t k : read_from_u) // item-read-depends on u with respect to key
+                            //&& i < vertices_[k].right()
+                            if (i != k)
                             {
-                                //&& i < vertices_[k].right()
-                                if (i != k)
-                                {
-                                    edges_.emplace(k, i); // item-anti-dependency
-                                }
+                                edges_.emplace(k, i); // item-anti-dependency
                             }
                         }
                         replacement_time[u.index()] = min(replacement_time[u.index()], v.end());
@@ -312,27 +299,19 @@ void Vbox::generate_item_constraint()
                         item_csts_.emplace_back(make_unique<ItemConstraint>(j, i));
                         ItemConstraint &item_cst = *item_csts_.back();
                         //(u -> v)
-                        if (u.reads().count(key) > 0)
+                        for (uint32_t k : index.readers(key, u.index()))
                         {
-                            const unordered_set<uint32_t> &read_from_u = u.reads().at(key);
-                            for (uint32_t k : read_from_u)
+                            if (i != k && i < vertices_[k].right())
                             {
-                                if (i != k && i < vertices_[k].right())
-                                {
-                                    item_cst.insert_alpha(k, i);
-                                }
+                                item_cst.insert_alpha(k, i);
                             }
                         }
                         //(v -> u)
-                        if (v.reads().count(key) > 0)
+                        for (uint32_t k : index.readers(key, v.index()))
                         {
-                            const unordered_set<uint32_t> &read_from_v = v.reads().at(key);
-                            for (uint32_t k : read_from_v)
+                            if (j != k && j < vertices_[k].right())
                             {
-                                if (j != k && j < vertices_[k].right())
-                                {
-                                    item_cst.insert_beta(k, j);
-                                }
+                                item_cst.insert_beta(k, j);
                             }
                         }
 
@@ -358,38 +337,136 @@ void Vbox::generate_item_constraint()
     }
 }
 
+// An install of a predicate field, kept in (key, trx) order together with the
+// range of values the key took in that field up to and including it.
+struct FieldVersion
+{
+    uint32_t key;
+    uint32_t trx;
+    uint32_t low;
+    uint32_t high;
+};
+
+// last install of the key before trx `left`, nullptr if there is none
+static const FieldVersion *last_version(const vector<FieldVersion> &versions, uint32_t key, uint32_t left)
+{
+    auto it = lower_bound(versions.begin(), versions.end(), make_pair(key, left),
+                          [](const FieldVersion &version, const pair<uint32_t, uint32_t> &bound)
+                          { return version.key < bound.first || (version.key == bound.first && version.trx < bound.second); });
+    if (it == versions.begin() || (it - 1)->key != key)
+    {
+        return nullptr;
+    }
+    return &*(it - 1);
+}
+
 void Vbox::generate_pred_constraint()
 {
+    const OperatorStore &ops = trx_manager_.operator_store();
+    const KeyIndex &index = trx_manager_.key_index();
+
+    // installs of every field some predicate ranges over, ascending by trx;
+    // writes to no such field can neither match nor contradict a predicate
+    unordered_map<uint64_t, vector<pair<uint32_t, uint32_t>>> field_installs; // field->[(trx,key)]
     for (size_t j = 0; j < n_; ++j)
     {
-        Vertex &v = vertices_[j];
-        if (v.predicates().empty())
+        for (const Predicate *p : vertices_[j].predicates())
         {
-            continue;
+            field_installs[p->field()];
         }
-        unordered_map<uint64_t, vector<pair<uint32_t, Write *>>> bound_installs; // key->[(trx,write)]
-        for (uint32_t p = v.left(); p < v.right(); ++p)
+    }
+    if (field_installs.empty())
+    {
+        return;
+    }
+    for (size_t i = 0; i < n_; ++i)
+    {
+        for (const auto &install : vertices_[i].writes())
         {
-            const auto &trx_installs = vertices_[p].writes();
-            for (const auto &install : trx_installs)
+            for (const FieldUpdate &update : install.second.updates())
             {
-                bound_installs[install.first].push_back(make_pair(p, install.second));
+                auto it = field_installs.find(update.field);
+                if (it != field_installs.end())
+                {
+                    it->second.emplace_back(i, install.first);
+                }
             }
         }
+    }
+    unordered_map<uint64_t, vector<FieldVersion>> field_versions;
+    for (const auto &entry : field_installs)
+    {
+        vector<FieldVersion> &versions = field_versions[entry.first];
+        versions.reserve(entry.second.size());
+        for (const auto &install : entry.second)
+        {
+            uint32_t value = vertices_[install.first].write(install.second)->find(entry.first)->value;
+            versions.push_back(FieldVersion{install.second, install.first, value, value});
+        }
+        sort(versions.begin(), versions.end(), [](const FieldVersion &a, const FieldVersion &b)
+             { return a.key < b.key || (a.key == b.key && a.trx < b.trx); });
+        for (size_t m = 1; m < versions.size(); ++m)
+        {
+            if (versions[m].key == versions[m - 1].key)
+            {
+                versions[m].low = min(versions[m].low, versions[m - 1].low);
+                versions[m].high = max(versions[m].high, versions[m - 1].high);
+            }
+        }
+    }
+
+    vector<uint64_t> fields;
+    vector<pair<uint32_t, uint32_t>> bound_installs;      // (key,trx) of the relevant writes in the window
+    vector<pair<uint32_t, const Write *>> key_installers; // [(trx,write)] of one key
+    for (size_t j = 0; j < n_; ++j)
+    {
+        Vertex &v = vertices_[j];
+        if (v.predicates().empty())
+        {
+            continue;
+        }
         UnitedPredicate u_pred;
-        for (Predicate *p : v.predicates())
+        fields.clear();
+        for (const Predicate *p : v.predicates())
         {
             u_pred.add(p);
+            fields.push_back(p->field());
         }
+        sort(fields.begin(), fields.end());
+        fields.erase(unique(fields.begin(), fields.end()), fields.end());
 
-        for (const auto &entry : bound_installs)
+        bound_installs.clear();
+        for (uint64_t field : fields)
         {
-            uint64_t key = entry.first;
-            if (u_pred.cover(key))
+            const vector<pair<uint32_t, uint32_t>> &installs = field_installs[field];
+            auto first = lower_bound(installs.begin(), installs.end(), make_pair(v.left(), 0u));
+            auto last = lower_bound(first, installs.end(), make_pair(v.right(), 0u));
+            for (auto it = first; it != last; ++it)
+            {
+                bound_installs.emplace_back(it->second, it->first);
+            }
+        }
+        sort(bound_installs.begin(), bound_installs.end());
+        bound_installs.erase(unique(bound_installs.begin(), bound_installs.end()), bound_installs.end());
+
+        for (size_t begin = 0, end = 0; begin < bound_installs.size(); begin = end)
+        {
+            uint32_t key = bound_installs[begin].first;
+            end = begin + 1;
+            while (end < bound_installs.size() && bound_installs[end].first == key)
+            {
+                ++end;
+            }
+            if (u_pred.cover(ops.key_of(key)))
             {
                 continue;
             }
-            const vector<pair<uint32_t, Write *>> &key_installers = entry.second;
+            key_installers.clear();
+            for (size_t m = begin; m < end; ++m)
+            {
+                uint32_t i = bound_installs[m].second;
+                key_installers.emplace_back(i, vertices_[i].write(key));
+            }
 
             pred_csts_.emplace_back(make_unique<PredicateConstraint>(j));
             PredicateConstraint &pred_cst = *pred_csts_.back();
@@ -401,7 +478,7 @@ void Vbox::generate_pred_constraint()
                 {
                     continue;
                 }
-                Write *write = key_installers[m].second;
+                const Write *write = key_installers[m].second;
 
                 if (!u_pred.relevant(write) || u_pred.match(write))
                 {
@@ -415,7 +492,7 @@ void Vbox::generate_pred_constraint()
                 for (size_t n = m + 1; n < key_installers.size(); ++n)
                 {
                     uint32_t k = key_installers[n].first;
-                    Write *write_ = key_installers[n].second;
+                    const Write *write_ = key_installers[n].second;
                     if (u_pred.match(write_) && u_pred.relevant(write_))
                     {
                         DSG::Edge rw(j, k);
@@ -437,7 +514,7 @@ void Vbox::generate_pred_constraint()
                 for (int n = m - 1; n >= 0; --n)
                 {
                     uint32_t k = key_installers[n].first;
-                    Write *write_ = key_installers[n].second;
+                    const Write *write_ = key_installers[n].second;
                     if (k < vertices_[i].left())
                     {
                         break;
@@ -455,33 +532,54 @@ void Vbox::generate_pred_constraint()
                     }
                 }
             }
-            for (uint32_t i : installs_[key])
+            // is some version before the window relevant but unmatched? with a single field
+            // the value range of those versions settles most keys without walking them
+            auto scan = [&]()
             {
-                if (i >= v.left())
+                VertexRange installers = index.installers(key);
+                const uint32_t *end = lower_bound(installers.begin(), installers.end(), v.left());
+                for (const uint32_t *it = installers.begin(); it != end; ++it)
                 {
-                    break;
+                    const Write *write_ = vertices_[*it].write(key);
+                    if (!u_pred.match(write_) && u_pred.relevant(write_))
+                    {
+                        return true;
+                    }
                 }
-                Write *write_ = vertices_[i].writes().at(key);
-                if (!u_pred.match(write_) && u_pred.relevant(write_))
+                return false;
+            };
+            bool unmatched = false;
+            if (fields.size() == 1)
+            {
+                const FieldVersion *last = last_version(field_versions[fields[0]], key, v.left());
+                if (last != nullptr && !u_pred.contains(fields[0], last->low, last->high))
                 {
-                    PredicateDirection *direction = pred_cst.add(0);
-                    // determined_directions_[DSG::Edge(0, j)].insert(direction); // wr
-                    for (size_t m = 0; m < key_installers.size(); ++m)
+                    unmatched = !u_pred.contains(fields[0], last->low, last->low) ||
+                                !u_pred.contains(fields[0], last->high, last->high) || scan();
+                }
+            }
+            else
+            {
+                unmatched = scan();
+            }
+            if (unmatched)
+            {
+                PredicateDirection *direction = pred_cst.add(0);
+                // determined_directions_[DSG::Edge(0, j)].insert(direction); // wr
+                for (size_t m = 0; m < key_installers.size(); ++m)
+                {
+                    uint32_t k = key_installers[m].first;
+                    if (k == j || vertices_[j].right() <= k)
                     {
-                        uint32_t k = key_installers[m].first;
-                        if (k == j || vertices_[j].right() <= k)
-                        {
-                            continue;
-                        }
-                        Write *write__ = key_installers[m].second;
-                        if (u_pred.match(write__) && u_pred.relevant(write__))
-                        {
-                            DSG::Edge rw(j, k);
-                            direction->insert_determined(j, k); // rw
-                            determined_directions_[rw].insert(direction);
-                        }
+                        continue;
+                    }
+                    const Write *write__ = key_installers[m].second;
+                    if (u_pred.match(write__) && u_pred.relevant(write__))
+                    {
+                        DSG::Edge rw(j, k);
+                        direction->insert_determined(j, k); // rw
+                        determined_directions_[rw].insert(direction);
                     }
-                    break;
                 }
             }
             if (pred_cst.size() == 0)
@@ -956,104 +1054,124 @@ void Vbox::prune_opt()
     }
 }
 
-void Vbox::check_read(vector<Read *> &reads)
+void Vbox::check_read()
 {
-    for (Read *read : reads)
+    // validated while the reads were resolved at load time
+    uint32_t k = trx_manager_.invalid_read();
+    if (k == UINT32_MAX)
     {
-        if (read->from_tid() != 0)
-        {
-            if (tid2index_.count(read->from_tid()) == 0)
-            {
-                throw AbortedReads(read);
-            }
-            auto &installs = vertices_[tid2index_[read->from_tid()]].writes();
-            if (installs.count(read->key()) == 0 || installs.at(read->key())->oid() != read->from_oid())
-            {
-                throw IntermediateReads(vertices_[tid2index_[read->from_tid()]].transaction(), read);
-            }
-        }
+        return;
+    }
+    const OperatorStore &ops = trx_manager_.operator_store();
+    uint32_t from = ops.from_vertex(k);
+    if (from == UINT32_MAX)
+    {
+        throw AbortedReads(ops.to_string(k));
     }
+    throw IntermediateReads(vertices_[from].transaction(), ops.to_string(k));
 }
 
 void Vbox::init()
 {
-    vector<Read *> reads;
-    for (size_t i = 0; i < n_; ++i)
+    check_read();
+    const OperatorStore &ops = trx_manager_.operator_store();
+    // installs and predicates only touch their own vertex, so vertices are split across threads
+    auto collect = [&](size_t begin, size_t end)
     {
-        Vertex &v = vertices_[i];
-        //<<v.to_string()<<endl;
-        Transaction *trx = v.transaction();
-        for (const unique_ptr<Operator> &op : trx->operators())
+        for (size_t i = begin; i < end; ++i)
         {
-            switch (op->type())
-            {
-            case OperatorType::READ:
-            {
-                Read *read = static_cast<Read *>(op.get());
-                reads.push_back(read);
-                // assert(tid2index_.count(read->from_tid())>0);
-                Vertex &from = vertices_[tid2index_[read->from_tid()]];
-                from.set_read(read->key(), i);
-                edges_.emplace(from.index(), i); // wr
-            }
-            break;
-            case OperatorType::WRITE:
+            Vertex &v = vertices_[i];
+            Transaction *trx = v.transaction();
+            for (uint32_t k = trx->ops_begin(); k < trx->ops_end(); ++k)
             {
-                Write *write = static_cast<Write *>(op.get());
-                installs_[write->key()].insert(i);
-                v.set_write(write->key(), write);
+                if (ops.type(k) == OperatorType::WRITE)
+                {
+                    v.set_write(ops.key_id(k), ops.write(k));
+                }
+                else if (ops.type(k) == OperatorType::PREDICATE)
+                {
+                    v.set_predicate(&ops.predicate(k));
+                }
             }
-            break;
-            case OperatorType::PREDICATE:
+        }
+    };
+    size_t n_threads = min<size_t>(max(options_.threads, 1), (n_ + 1023) / 1024);
+    vector<thread> workers;
+    for (size_t t = 1; t < n_threads; ++t)
+    {
+        workers.emplace_back(collect, n_ * t / n_threads, n_ * (t + 1) / n_threads);
+    }
+    collect(0, n_threads > 1 ? n_ / n_threads : n_);
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    for (size_t i = 0; i < n_; ++i)
+    {
+        Transaction *trx = vertices_[i].transaction();
+        for (uint32_t k = trx->ops_begin(); k < trx->ops_end(); ++k)
+        {
+            if (ops.type(k) == OperatorType::READ && ops.from_vertex(k) != UINT32_MAX) // otherwise rejected by check_read
             {
-                Predicate *predicate = static_cast<Predicate *>(op.get());
-                v.set_predicate(predicate);
-            }
-            break;
-            default:
-                break;
+                edges_.emplace(ops.from_vertex(k), i); // wr
             }
         }
     }
-    check_read(reads);
-    reads.clear();
     if (options_.time)
     {
-        unordered_map<uint32_t, uint64_t> replacement_time;
-        vector<uint32_t> active_vertices;
+        // Sweep over the vertices in start order, as the history is merged. A vertex
+        // runs until the first later vertex that starts after it ends: that one is its
+        // right bound. Among the still running vertices the smallest is the left bound.
+        using Ending = pair<uint64_t, uint32_t>; // (end, vertex)
+        priority_queue<Ending, vector<Ending>, greater<Ending>> running;
+        vector<Ending> records; // vertices ending later than every vertex before them
+        vector<uint32_t> finished; // ended, and not yet followed by a vertex that ran entirely after them
+        vector<uint64_t> replacement_time(options_.collect ? n_ : 0, UINT64_MAX);
         for (size_t j = 0; j < n_; ++j)
         {
             Vertex &v = vertices_[j];
-            auto it = active_vertices.begin();
-            while (it != active_vertices.end())
+            while (!running.empty() && running.top().first <= v.start())
             {
-                Vertex &u = vertices_[*it];
-                if (replacement_time[u.index()] <= v.start())
+                uint32_t u = running.top().second;
+                running.pop();
+                vertices_[u].set_right(j);
+                if (options_.collect)
                 {
-                    it = active_vertices.erase(it);
+                    finished.push_back(u);
                 }
-                if (u.end() <= v.start())
+            }
+            // the first vertex ending after v starts is a record, and is still running
+            auto first = upper_bound(records.begin(), records.end(), make_pair(v.start(), UINT32_MAX));
+            if (first != records.end())
+            {
+                v.set_left(first->second);
+            }
+            if (options_.collect)
+            {
+                // u -> v, unless some vertex ran entirely between them
+                auto it = finished.begin();
+                for (uint32_t u : finished)
                 {
-                    ++it;
-                    u.set_right(j);
-                    if (options_.collect)
+                    if (replacement_time[u] <= v.start())
                     {
-                        edges_.emplace(u.index(), v.index());
+                        continue;
                     }
-                    replacement_time[u.index()] = min(replacement_time[u.index()], v.end());
-                }
-                else
-                {
-                    ++it;
-                    v.set_left(u.index());
+                    edges_.emplace(u, j);
+                    replacement_time[u] = min(replacement_time[u], v.end());
+                    *it++ = u;
                 }
+                finished.erase(it, finished.end());
+            }
+            running.emplace(v.end(), j);
+            if (records.empty() || records.back().first < v.end())
+            {
+                records.emplace_back(v.end(), j);
             }
-            active_vertices.push_back(j);
-            replacement_time[j] = UINT64_MAX;
         }
-        for (uint32_t i : active_vertices)
+        while (!running.empty())
         {
-            vertices_[i].set_right(n_);
+            vertices_[running.top().second].set_right(n_);
+            running.pop();
         }
     }
 }
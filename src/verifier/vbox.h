@@ -21,7 +21,7 @@ public:
 
 private:
     void init();
-    void check_read(std::vector<Read *> &reads);
+    void check_read();
     void generate_item_constraint();
     void merge_item_constraint(ItemConstraint &cst);
     void generate_pred_constraint();
@@ -39,8 +39,6 @@ private:
     TransactionManager trx_manager_;
     std::vector<Vertex> vertices_;
     std::unordered_set<DSG::Edge> edges_;
-    std::unordered_map<uint32_t, uint32_t> tid2index_;
-    std::unordered_map<uint64_t, std::set<uint32_t>> installs_;
     std::vector<std::unique_ptr<ItemConstraint>> item_csts_;
     std::vector<std::unique_ptr<PredicateConstraint>> pred_csts_;
 